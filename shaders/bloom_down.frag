@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 mtex;
+
+out vec4 FragColor;
+
+uniform sampler2D screen_texture;
+uniform vec2 texel;
+
+// Dual filter downsample: the centre plus four diagonal taps.
+void main() {
+    vec3 color = 4 * vec3(texture(screen_texture, mtex))
+               + vec3(texture(screen_texture, mtex + texel * vec2(-1, -1)))
+               + vec3(texture(screen_texture, mtex + texel * vec2( 1, -1)))
+               + vec3(texture(screen_texture, mtex + texel * vec2(-1,  1)))
+               + vec3(texture(screen_texture, mtex + texel * vec2( 1,  1)));
+    FragColor = vec4(color / 8, 1);
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+in vec2 mtex;
+
+out vec4 FragColor;
+
+uniform sampler2D screen_texture;
+uniform vec2 texel;
+uniform float threshold;
+
+vec3 bright(vec2 texpos) {
+    vec3 color = vec3(texture(screen_texture, texpos));
+    if (color.x + color.y + color.z < threshold) {
+        color = vec3(0);
+    }
+    return color;
+}
+
+// Each tap falls between four texels, so four taps cover a 4x4 block.
+void main() {
+    vec3 color = bright(mtex + texel * vec2(-1, -1))
+               + bright(mtex + texel * vec2( 1, -1))
+               + bright(mtex + texel * vec2(-1,  1))
+               + bright(mtex + texel * vec2( 1,  1));
+    FragColor = vec4(color / 4, 1);
+}
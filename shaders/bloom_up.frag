@@ -0,0 +1,23 @@
+#version 330 core
+
+in vec2 mtex;
+
+out vec4 FragColor;
+
+uniform sampler2D screen_texture;
+uniform vec2 texel;
+uniform float intensity;
+
+// Dual filter upsample: a tent of eight taps around the centre, added onto
+// the larger level by blending.
+void main() {
+    vec3 color = vec3(texture(screen_texture, mtex + texel * vec2(-2,  0)))
+               + vec3(texture(screen_texture, mtex + texel * vec2( 2,  0)))
+               + vec3(texture(screen_texture, mtex + texel * vec2( 0, -2)))
+               + vec3(texture(screen_texture, mtex + texel * vec2( 0,  2)))
+               + 2 * vec3(texture(screen_texture, mtex + texel * vec2(-1, -1)))
+               + 2 * vec3(texture(screen_texture, mtex + texel * vec2( 1, -1)))
+               + 2 * vec3(texture(screen_texture, mtex + texel * vec2(-1,  1)))
+               + 2 * vec3(texture(screen_texture, mtex + texel * vec2( 1,  1)));
+    FragColor = vec4(intensity * color / 12, 1);
+}
@@ -1,11 +1,10 @@
 #version 330 core
 
 in vec3 mid_pos;
+in vec3 color;
 
 out vec4 FragColor;
 
-uniform vec3 color;
-
 void main() {
     FragColor = vec4(color, 1);
 }
\ No newline at end of file
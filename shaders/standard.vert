@@ -1,13 +1,16 @@
 #version 330 core
 
 layout (location = 0) in vec3 vertex_pos;
+layout (location = 1) in mat4 instance_model;
+layout (location = 5) in vec3 instance_color;
 
 out vec3 mid_pos;
+out vec3 color;
 
 uniform mat4 trans_pv;
-uniform mat4 trans_model;
 
 void main() {
-    gl_Position = trans_pv * trans_model * vec4(vertex_pos, 1.0);
+    gl_Position = trans_pv * instance_model * vec4(vertex_pos, 1.0);
     mid_pos = vertex_pos;
+    color = instance_color;
 }
\ No newline at end of file
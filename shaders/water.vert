@@ -1,6 +1,9 @@
 #version 330 core
 
-layout (location = 0) in vec3 vertex_pos;
+// Per tile: origin x and z with the vertex spacing, and the distances from
+// lod_center over which its vertices morph.
+layout (location = 1) in vec3 tile;
+layout (location = 2) in vec2 tile_morph;
 
 out float mid_height;
 flat out vec3 mid_pos;
@@ -9,6 +12,11 @@ flat out vec3 mid_normal;
 uniform float time;
 uniform mat4 trans_pv;
 uniform mat4 trans_model;
+uniform bool use_ocean;
+uniform sampler2D ocean_map;
+uniform float ocean_length;
+uniform vec2 lod_center;
+uniform int patch_size;
 
 float heightAtPoint(vec3 pos) {
     float wavePresence = (sin((pos.x + pos.z + time)/16) + 1) / 2;
@@ -17,18 +25,38 @@ float heightAtPoint(vec3 pos) {
     return height;
 }
 
+// Ocean texels hold height, x and z displacement of the grid point at their
+// centre, so lookups shift by half a texel.
 vec3 posAtPoint(vec3 pos) {
+    if (use_ocean) {
+        vec2 uv = pos.xz / ocean_length + 0.5 / vec2(textureSize(ocean_map, 0));
+        vec3 ocean = texture(ocean_map, uv).rgb;
+        return pos + vec3(ocean.g, ocean.r, ocean.b);
+    }
     return pos + vec3(0, heightAtPoint(pos), 0);
 }
 
 void main() {
 
-    float height = heightAtPoint(vertex_pos);
-    vec3 pos = vertex_pos + vec3(0, height, 0);
+    // Towards the edge of the level, odd vertices slide onto their even
+    // neighbours so the edge matches the coarser level outside it.
+    // Coordinates within the patch, in grid steps, from the vertex number.
+    int row = patch_size + 1;
+    vec2 vertex = vec2(gl_VertexID / row, gl_VertexID % row);
+    float spacing = tile.z;
+    vec2 grid = tile.xy + vertex * spacing;
+    vec2 away = abs(grid - lod_center);
+    float reach = max(away.x, away.y);
+    float morph = clamp((reach - tile_morph.x) / (tile_morph.y - tile_morph.x), 0, 1);
+    grid -= mod(vertex, 2.0) * spacing * morph;
+    vec3 ground = vec3(grid.x, 0, grid.y);
 
-    vec3 posRight = posAtPoint(vertex_pos + vec3(1, 0, 0));
-    vec3 posFront = posAtPoint(vertex_pos + vec3(0, 0, 1));
-    vec3 normal = normalize(cross(posFront, posRight));
+    vec3 pos = posAtPoint(ground);
+    float height = pos.y;
+
+    vec3 posRight = posAtPoint(ground + vec3(spacing, 0, 0));
+    vec3 posFront = posAtPoint(ground + vec3(0, 0, spacing));
+    vec3 normal = normalize(cross(posFront - pos, posRight - pos));
 
     gl_Position = trans_pv * trans_model * vec4(pos, 1.0);
     mid_pos = pos;
@@ -0,0 +1,39 @@
+#include "alloc.hpp"
+#include "lg.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifndef NDEBUG
+
+static std::atomic<long long> allocations{0};
+
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+long long allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+#else
+
+long long allocationCount() { return 0; }
+
+#endif
+
+AllocationGuard::AllocationGuard(const char *scope, bool enabled)
+    : scope(scope), enabled(enabled), start(allocationCount()) {}
+
+AllocationGuard::~AllocationGuard() {
+  auto count = allocationCount() - start;
+  if (enabled and count != 0) {
+    lg.error(scope, " made ", count, " heap allocations in steady state\n");
+    std::exit(1);
+  }
+}
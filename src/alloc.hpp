@@ -0,0 +1,21 @@
+#ifndef SURFACES_ALLOC_HPP
+#define SURFACES_ALLOC_HPP
+
+// In builds without NDEBUG, global operator new is replaced by one that
+// counts calls, and AllocationGuard exits with an error if the scope it
+// covers allocated. Release builds compile both down to nothing.
+long long allocationCount();
+
+struct AllocationGuard {
+  explicit AllocationGuard(const char *scope, bool enabled = true);
+  ~AllocationGuard();
+  AllocationGuard(const AllocationGuard &) = delete;
+  AllocationGuard &operator=(const AllocationGuard &) = delete;
+
+private:
+  const char *scope;
+  bool enabled;
+  long long start;
+};
+
+#endif // SURFACES_ALLOC_HPP
@@ -0,0 +1,184 @@
+#include "assets.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include "programcache.hpp"
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+static std::string vertexPath(const std::string &name) {
+  return "shaders/" + name + ".vert";
+}
+
+static std::string fragmentPath(const std::string &name) {
+  return "shaders/" + name + ".frag";
+}
+
+static std::string programKey(const std::string &vertexName,
+                              const std::string &fragmentName) {
+  return vertexName + "/" + fragmentName;
+}
+
+template <typename Clock>
+static double millisecondsSince(typename Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+Assets::Assets()
+    : work(), sources(), images(), programNames(), programs(), phases(),
+      loader(), begin(Clock::now()), last(begin), loadMs(0.0) {}
+
+Assets::~Assets() {
+  wait();
+  for (auto &[path, image] : images)
+    if (image)
+      image->free();
+}
+
+// Each file is read once however many programs share it.
+void Assets::source(const std::string &path) {
+  if (sources.count(path))
+    return;
+  auto &text = sources[path];
+  work.push_back({path, [path, &text] { text = readFile(path); }, 0.0});
+}
+
+void Assets::program(const std::string &vertexName,
+                     const std::string &fragmentName) {
+  source(vertexPath(vertexName));
+  source(fragmentPath(fragmentName));
+  programNames.emplace_back(vertexName, fragmentName);
+}
+
+void Assets::image(const std::string &path) {
+  if (images.count(path))
+    return;
+  auto &image = images[path];
+  work.push_back({path, [path, &image] { image = Image::load(path); }, 0.0});
+}
+
+void Assets::task(const std::string &name, std::function<void()> fn) {
+  work.push_back({name, std::move(fn), 0.0});
+}
+
+void Assets::start() {
+  loader = std::thread([this] {
+    auto start = Clock::now();
+    parallelFor((int)work.size(), 1, [this](int first, int end) {
+      for (auto i = first; i < end; ++i) {
+        auto jobStart = Clock::now();
+        work[i].fn();
+        work[i].ms = millisecondsSince<Clock>(jobStart);
+      }
+    });
+    loadMs = millisecondsSince<Clock>(start);
+  });
+}
+
+void Assets::wait() {
+  if (loader.joinable())
+    loader.join();
+}
+
+// Programs the binary cache restores are done at once; only the shaders the
+// rest need are compiled.
+void Assets::build() {
+  wait();
+  auto pending = std::vector<std::pair<int, Program>>();
+  auto needed = std::set<std::string>();
+  for (auto i = 0; i < (int)programNames.size(); ++i) {
+    auto &[vertexName, fragmentName] = programNames[i];
+    auto program = Program();
+    if (programCache != nullptr and
+        programCache->load(program, sources.at(vertexPath(vertexName)),
+                           sources.at(fragmentPath(fragmentName)))) {
+      programs.emplace(programKey(vertexName, fragmentName), program);
+      continue;
+    }
+    pending.emplace_back(i, program);
+    needed.insert(vertexPath(vertexName));
+    needed.insert(fragmentPath(fragmentName));
+  }
+  auto shaders = std::map<std::string, Shader>();
+  for (auto &path : needed) {
+    auto vertex = path.size() >= 5 and
+                  path.compare(path.size() - 5, 5, ".vert") == 0;
+    auto shader = Shader(vertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
+    shader.source(1, sources.at(path), nullptr);
+    shader.beginCompile();
+    shaders.emplace(path, shader);
+  }
+  for (auto &[i, program] : pending) {
+    auto &[vertexName, fragmentName] = programNames[i];
+    program.attach(shaders.at(vertexPath(vertexName)));
+    program.attach(shaders.at(fragmentPath(fragmentName)));
+    if (programCache != nullptr)
+      programCache->prepare(program);
+    program.beginLink();
+  }
+  for (auto &[path, shader] : shaders)
+    shader.endCompile();
+  for (auto &[i, program] : pending) {
+    auto &[vertexName, fragmentName] = programNames[i];
+    program.endLink();
+    if (programCache != nullptr)
+      programCache->store(program, sources.at(vertexPath(vertexName)),
+                          sources.at(fragmentPath(fragmentName)));
+    programs.emplace(programKey(vertexName, fragmentName), program);
+  }
+  for (auto &[path, shader] : shaders)
+    shader.free();
+  sources.clear();
+}
+
+const Image &Assets::loadedImage(const std::string &path) {
+  wait();
+  auto found = images.find(path);
+  if (found == images.end() or not found->second) {
+    lg.error("image ", path, " was not loaded at startup\n");
+    std::exit(1);
+  }
+  return *found->second;
+}
+
+std::optional<Program> Assets::takeProgram(const std::string &vertexName,
+                                           const std::string &fragmentName) {
+  wait();
+  auto found = programs.find(programKey(vertexName, fragmentName));
+  if (found == programs.end())
+    return std::nullopt;
+  auto program = found->second;
+  programs.erase(found);
+  return program;
+}
+
+void Assets::mark(const std::string &phase) {
+  auto now = Clock::now();
+  phases.emplace_back(
+      phase, std::chrono::duration<double, std::milli>(now - last).count());
+  last = now;
+}
+
+void Assets::report() const {
+  auto list = std::ostringstream();
+  for (auto &[phase, ms] : phases)
+    list << ", " << phase << " " << ms << " ms";
+  lg.info("startup ",
+          std::chrono::duration<double, std::milli>(last - begin).count(),
+          " ms", list.str(), "\n");
+  if (work.empty())
+    return;
+  auto total = 0.0;
+  for (auto &job : work)
+    total += job.ms;
+  auto slowest = std::max_element(
+      work.begin(), work.end(),
+      [](const Job &a, const Job &b) { return a.ms < b.ms; });
+  lg.info("startup loading: ", work.size(), " jobs, ", total,
+          " ms of work in ", loadMs, " ms on ",
+          jobs != nullptr ? jobs->threadCount() : 1, " threads, slowest ",
+          slowest->name, " ", slowest->ms, " ms\n");
+}
+
+Assets *assets = nullptr;
@@ -0,0 +1,68 @@
+#ifndef SURFACES_ASSETS_HPP
+#define SURFACES_ASSETS_HPP
+
+#include "xgl.hpp"
+#include <chrono>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Startup loading, split between worker threads and the context thread.
+// Everything asked for with program(), image() and task() is read, decoded or
+// built by start() on a loader thread that spreads the work over the job
+// system, so the context thread can create the window meanwhile. build() then
+// creates the GL objects on the context thread in one batch: programs the
+// program cache holds are restored from their binaries, and for the rest
+// every shader is compiled before any status is queried and every program
+// linked before any is checked, which lets the driver overlap the work.
+//
+// While it is set, shaderProgramFromAsset() hands out the programs built here
+// instead of reading and compiling its own. Nothing else may use the job
+// system between start() and wait().
+struct Assets {
+  Assets();
+  ~Assets();
+  Assets(const Assets &) = delete;
+  Assets &operator=(const Assets &) = delete;
+  void program(const std::string &vertexName, const std::string &fragmentName);
+  void image(const std::string &path);
+  void task(const std::string &name, std::function<void()> fn);
+  void start();
+  void wait();
+  void build();
+  // Both wait for loading to finish. Images stay owned by Assets, and each
+  // program can be taken once.
+  const Image &loadedImage(const std::string &path);
+  std::optional<Program> takeProgram(const std::string &vertexName,
+                                     const std::string &fragmentName);
+  // Closes the current startup phase under the given name; report() logs
+  // every phase and the time the off-thread jobs took.
+  void mark(const std::string &phase);
+  void report() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+  struct Job {
+    std::string name;
+    std::function<void()> fn;
+    double ms;
+  };
+  void source(const std::string &path);
+  std::vector<Job> work;
+  std::map<std::string, std::string> sources;
+  std::map<std::string, std::optional<Image>> images;
+  std::vector<std::pair<std::string, std::string>> programNames;
+  std::map<std::string, Program> programs;
+  std::vector<std::pair<std::string, double>> phases;
+  std::thread loader;
+  Clock::time_point begin, last;
+  double loadMs;
+};
+
+// shaderProgramFromAsset() takes prebuilt programs from here when it is set.
+extern Assets *assets;
+
+#endif // SURFACES_ASSETS_HPP
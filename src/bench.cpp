@@ -0,0 +1,276 @@
+#include "lg.hpp"
+#include "math.hpp"
+#include "physics.hpp"
+#include "waterpatch.hpp"
+#include "wave.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the physics, wave and mesh hot paths. Links neither
+// GLFW nor GL. Each benchmark runs in batches, grown until one batch takes at
+// least --min-time seconds, and is then timed over --samples batches. The
+// median is reported in ns per iteration. --json saves the results, and
+// --baseline compares them with a saved run. The exit status is 1 if any
+// benchmark got slower by more than --threshold.
+
+struct BenchOptions {
+  const char *filter = "";
+  const char *json = nullptr;
+  const char *baseline = nullptr;
+  double threshold = 0.10;
+  int samples = 7;
+  double minTime = 0.02;
+};
+
+struct Benchmark {
+  std::string name;
+  std::function<void(long long iterations)> run;
+};
+
+struct BenchResult {
+  std::string name;
+  long long iterations;
+  double ns;  // median per iteration
+  double min; // fastest sample per iteration
+};
+
+static BenchOptions parseOptions(int argc, char **argv) {
+  auto options = BenchOptions();
+  for (auto i = 1; i < argc; ++i) {
+    auto flag = argv[i];
+    if (i + 1 >= argc) {
+      lg.error("missing value for ", flag, "\n");
+      std::exit(1);
+    }
+    auto value = argv[++i];
+    if (not strcmp(flag, "--filter"))
+      options.filter = value;
+    else if (not strcmp(flag, "--json"))
+      options.json = value;
+    else if (not strcmp(flag, "--baseline"))
+      options.baseline = value;
+    else if (not strcmp(flag, "--threshold"))
+      options.threshold = std::atof(value);
+    else if (not strcmp(flag, "--samples"))
+      options.samples = std::max(std::atoi(value), 1);
+    else if (not strcmp(flag, "--min-time"))
+      options.minTime = std::atof(value);
+    else {
+      lg.error("unknown flag ", flag, "\n");
+      std::exit(1);
+    }
+  }
+  return options;
+}
+
+// Keeps the compiler from dropping a computation whose result is unused.
+template <typename T> static void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+static const auto raftScale = glm::vec3(10.0f, 0.5f, 10.0f);
+
+static RaftPhysics benchRaft(int probes) {
+  return RaftPhysics({500.0f, 10.0f, 500.0f}, raftScale,
+                     wood.density * volume(raftScale), probes);
+}
+
+static std::vector<Benchmark> benchmarks() {
+  auto list = std::vector<Benchmark>();
+  list.push_back({"wave/waveHeightAtPoint", [](long long n) {
+                    for (auto i = 0ll; i < n; ++i)
+                      keep(waveHeightAtPoint({(float)(i & 1023), 0.0f,
+                                              (float)(i >> 10 & 1023)},
+                                             1.0f));
+                  }});
+  list.push_back({"wave/waveHeights/1024", [](long long n) {
+                    auto xs = std::vector<float>(1024);
+                    auto zs = std::vector<float>(1024);
+                    auto heights = std::vector<float>(1024);
+                    for (auto i = 0; i < 1024; ++i)
+                      xs[i] = (float)(i % 32), zs[i] = (float)(i / 32);
+                    for (auto i = 0ll; i < n; ++i) {
+                      waveHeights(xs.data(), zs.data(), heights.data(), 1024,
+                                  (float)i / 240);
+                      keep(heights[0]);
+                    }
+                  }});
+  for (auto probes : {8, 32, 128}) {
+    auto suffix = "/probes=" + std::to_string(probes);
+    list.push_back({"physics/computeForces" + suffix, [probes](long long n) {
+                      auto raft = benchRaft(probes);
+                      for (auto i = 0ll; i < n; ++i)
+                        keep(raft.computeForces((float)i / 240));
+                    }});
+    // The raft is put back every 128 steps so it never drifts into states
+    // that are cheaper or dearer to step than a floating one.
+    list.push_back({"physics/update" + suffix, [probes](long long n) {
+                      auto start = benchRaft(probes);
+                      auto raft = start;
+                      for (auto i = 0ll; i < n; ++i) {
+                        if (i % 128 == 0)
+                          raft = start;
+                        raft.update(1.0f / 240, (float)i / 240);
+                        keep(raft.position);
+                      }
+                    }});
+  }
+  list.push_back({"physics/acuteAngle", [](long long n) {
+                    auto directions = std::vector<glm::vec2>(256);
+                    for (auto i = 0; i < 256; ++i)
+                      directions[i] = {cosf(i * 0.1f), sinf(i * 0.1f)};
+                    for (auto i = 0ll; i < n; ++i)
+                      keep(acuteAngle(directions[i & 255],
+                                      directions[(i * 7 + 3) & 255]));
+                  }});
+  list.push_back({"physics/dragCoefficient", [](long long n) {
+                    auto angles = std::vector<float>(256);
+                    for (auto i = 0; i < 256; ++i)
+                      angles[i] = i * (float)M_PI / 2 / 255;
+                    for (auto i = 0ll; i < n; ++i)
+                      keep(dragCoefficient(angles[i & 255]));
+                  }});
+  for (auto size : {16, 64}) {
+    list.push_back({"mesh/waterPatch/" + std::to_string(size),
+                    [size](long long n) {
+                      for (auto i = 0ll; i < n; ++i)
+                        keep(WaterPatch(size).indexCount);
+                    }});
+  }
+  return list;
+}
+
+static double secondsFor(const Benchmark &bench, long long iterations) {
+  auto start = std::chrono::steady_clock::now();
+  bench.run(iterations);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+static BenchResult measure(const Benchmark &bench,
+                           const BenchOptions &options) {
+  auto iterations = 1ll;
+  while (true) {
+    auto seconds = secondsFor(bench, iterations);
+    if (seconds >= options.minTime or iterations >= 1ll << 40)
+      break;
+    auto scale = seconds > 0 ? 1.2 * options.minTime / seconds : 100.0;
+    iterations = (long long)std::ceil(iterations * std::clamp(scale, 2.0,
+                                                              100.0));
+  }
+  auto samples = std::vector<double>();
+  for (auto i = 0; i < options.samples; ++i)
+    samples.push_back(1e9 * secondsFor(bench, iterations) / iterations);
+  std::sort(samples.begin(), samples.end());
+  return {bench.name, iterations, samples[samples.size() / 2], samples[0]};
+}
+
+static void writeJson(const std::vector<BenchResult> &results,
+                      const std::string &path) {
+  auto file = std::ofstream(path);
+  if (not file) {
+    lg.error("failed to open ", path, "\n");
+    std::exit(1);
+  }
+  file << std::setprecision(6) << "{\n  \"benchmarks\": [";
+  for (auto i = 0; i < (int)results.size(); ++i) {
+    auto &result = results[i];
+    file << (i > 0 ? "," : "") << "\n    {\"name\": \"" << result.name
+         << "\", \"iterations\": " << result.iterations
+         << ", \"ns\": " << result.ns << ", \"min\": " << result.min << "}";
+  }
+  file << "\n  ]\n}\n";
+}
+
+// Reads back what writeJson() wrote: each "name" followed by its "ns".
+static std::vector<BenchResult> readJson(const std::string &path) {
+  auto file = std::ifstream(path);
+  if (not file) {
+    lg.error("failed to open baseline ", path, "\n");
+    std::exit(1);
+  }
+  auto text = (std::ostringstream() << file.rdbuf()).str();
+  auto results = std::vector<BenchResult>();
+  auto at = text.find("\"name\"");
+  while (at != std::string::npos) {
+    auto open = text.find('"', text.find(':', at) + 1);
+    auto close = text.find('"', open + 1);
+    auto ns = text.find("\"ns\"", close);
+    if (open == std::string::npos or close == std::string::npos or
+        ns == std::string::npos) {
+      lg.error("malformed baseline ", path, "\n");
+      std::exit(1);
+    }
+    auto value = std::strtod(text.c_str() + text.find(':', ns) + 1, nullptr);
+    results.push_back({text.substr(open + 1, close - open - 1), 0, value, 0});
+    at = text.find("\"name\"", close);
+  }
+  return results;
+}
+
+// Logs each benchmark against its baseline and returns how many regressed.
+static int compare(const std::vector<BenchResult> &results,
+                   const std::vector<BenchResult> &baseline,
+                   double threshold) {
+  auto regressions = 0;
+  for (auto &result : results) {
+    auto old = std::find_if(
+        baseline.begin(), baseline.end(),
+        [&](const BenchResult &entry) { return entry.name == result.name; });
+    if (old == baseline.end()) {
+      lg.info(std::left, std::setw(36), result.name, " not in baseline\n");
+      continue;
+    }
+    auto change = result.ns / old->ns - 1;
+    if (change > threshold) {
+      ++regressions;
+      lg.error(std::left, std::setw(36), result.name, std::right,
+               std::setw(12), old->ns, " -> ", std::setw(12), result.ns,
+               " ns (", std::showpos, 100 * change, std::noshowpos,
+               "%) regressed\n");
+    } else {
+      lg.info(std::left, std::setw(36), result.name, std::right,
+              std::setw(12), old->ns, " -> ", std::setw(12), result.ns,
+              " ns (", std::showpos, 100 * change, std::noshowpos, "%)\n");
+    }
+  }
+  return regressions;
+}
+
+int main(int argc, char **argv) {
+  auto options = parseOptions(argc, argv);
+  std::cout << std::fixed << std::setprecision(1);
+  auto results = std::vector<BenchResult>();
+  for (auto &bench : benchmarks()) {
+    if (bench.name.find(options.filter) == std::string::npos)
+      continue;
+    results.push_back(measure(bench, options));
+    auto &result = results.back();
+    lg.info(std::left, std::setw(36), result.name, std::right, std::setw(12),
+            result.ns, " ns  (min ", result.min, ", ", result.iterations,
+            " iterations)\n");
+  }
+  if (options.json != nullptr)
+    writeJson(results, options.json);
+  if (options.baseline == nullptr)
+    return 0;
+  auto regressions =
+      compare(results, readJson(options.baseline), options.threshold);
+  if (regressions > 0) {
+    lg.error(regressions, " benchmarks regressed by more than ",
+             100 * options.threshold, "%\n");
+    return 1;
+  }
+  return 0;
+}
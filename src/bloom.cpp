@@ -0,0 +1,92 @@
+#include "bloom.hpp"
+#include <algorithm>
+
+// Points the screen vertex shader at the whole target and returns the
+// fragment shader's texel size uniform.
+static Uniform screenTexel(Program &program) {
+  program.use();
+  auto pos1 = program.locateUniform("pos1");
+  auto pos2 = program.locateUniform("pos2");
+  pos1 = glm::vec2(0.0f, 0.0f);
+  pos2 = glm::vec2(1.0f, 1.0f);
+  return program.locateUniform("texel");
+}
+
+Bloom::Bloom(int width, int height, int levelCount, QuadVertices &quad)
+    : threshold(1.55f), intensity(1.0f), quad(quad), levels(),
+      extract(shaderProgramFromAsset("screen", "bloom_extract")),
+      down(shaderProgramFromAsset("screen", "bloom_down")),
+      up(shaderProgramFromAsset("screen", "bloom_up")),
+      extractTexel(screenTexel(extract)),
+      extractThreshold(extract.locateUniform("threshold")),
+      downTexel(screenTexel(down)), upTexel(screenTexel(up)),
+      upIntensity(up.locateUniform("intensity")) {
+  auto levelWidth = std::max(width / 2, 1);
+  auto levelHeight = std::max(height / 2, 1);
+  for (auto i = 0; i < std::max(levelCount, 1); ++i) {
+    if (i > 0 and (levelWidth < 2 or levelHeight < 2))
+      break;
+    levels.push_back({Texture(), FBO(), levelWidth, levelHeight});
+    auto &level = levels.back();
+    level.texture.bind(GL_TEXTURE_2D);
+    level.texture.image2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, levelWidth,
+                          levelHeight, 0, GL_RGB, GL_FLOAT, nullptr);
+    level.texture.parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    level.texture.parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    level.texture.parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
+                            GL_CLAMP_TO_EDGE);
+    level.texture.parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
+                            GL_CLAMP_TO_EDGE);
+    level.texture.unbind(GL_TEXTURE_2D);
+    level.fbo.bind(GL_FRAMEBUFFER);
+    level.fbo.texture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                        level.texture, 0);
+    level.fbo.xassertComplete(GL_FRAMEBUFFER);
+    level.fbo.unbind(GL_FRAMEBUFFER);
+    levelWidth = std::max(levelWidth / 2, 1);
+    levelHeight = std::max(levelHeight / 2, 1);
+  }
+}
+
+void Bloom::pass(Program &program, Uniform &texel, Texture &source,
+                 glm::vec2 sourceTexel, int width, int height) {
+  glViewport(0, 0, width, height);
+  program.use();
+  texel = sourceTexel;
+  quad.draw(source);
+}
+
+// The upsample taps reach a source texel along the axes and half one along
+// the diagonals, so they get half the texel size.
+void Bloom::render(Texture &source, int sourceWidth, int sourceHeight,
+                   int width, int height) {
+  extract.use();
+  extractThreshold = threshold;
+  auto &first = levels.front();
+  first.fbo.bind(GL_FRAMEBUFFER);
+  pass(extract, extractTexel, source,
+       1.0f / glm::vec2(sourceWidth, sourceHeight), first.width,
+       first.height);
+  for (auto i = 1; i < (int)levels.size(); ++i) {
+    auto &from = levels[i - 1];
+    levels[i].fbo.bind(GL_FRAMEBUFFER);
+    pass(down, downTexel, from.texture,
+         1.0f / glm::vec2(from.width, from.height), levels[i].width,
+         levels[i].height);
+  }
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  up.use();
+  upIntensity = 1.0f;
+  for (auto i = (int)levels.size() - 1; i > 0; --i) {
+    auto &from = levels[i];
+    levels[i - 1].fbo.bind(GL_FRAMEBUFFER);
+    pass(up, upTexel, from.texture, 0.5f / glm::vec2(from.width, from.height),
+         levels[i - 1].width, levels[i - 1].height);
+  }
+  first.fbo.unbind(GL_FRAMEBUFFER);
+  upIntensity = intensity;
+  pass(up, upTexel, first.texture,
+       0.5f / glm::vec2(first.width, first.height), width, height);
+  glDisable(GL_BLEND);
+}
@@ -0,0 +1,36 @@
+#ifndef SURFACES_BLOOM_HPP
+#define SURFACES_BLOOM_HPP
+
+#include "models.hpp"
+#include "xgl.hpp"
+#include <vector>
+
+// Bloom in three steps. A bright pass writes into a half-resolution level.
+// A dual filter blur then runs down a chain of levels, each half the size of
+// the one before, and back up, adding each level onto the next larger one.
+// The last step adds level 0 onto the framebuffer. Apart from the final
+// composite, every pass is at half resolution or below.
+struct Bloom {
+  Bloom(int width, int height, int levels, QuadVertices &quad);
+  // Blooms a sourceWidth x sourceHeight source onto the default
+  // framebuffer, which is width x height.
+  void render(Texture &source, int sourceWidth, int sourceHeight, int width,
+              int height);
+  float threshold; // summed RGB a texel needs to bloom
+  float intensity;
+
+private:
+  struct Level {
+    Texture texture;
+    FBO fbo;
+    int width, height;
+  };
+  void pass(Program &program, Uniform &texel, Texture &source,
+            glm::vec2 sourceTexel, int width, int height);
+  QuadVertices &quad;
+  std::vector<Level> levels;
+  Program extract, down, up;
+  Uniform extractTexel, extractThreshold, downTexel, upTexel, upIntensity;
+};
+
+#endif // SURFACES_BLOOM_HPP
@@ -45,3 +45,27 @@ glm::mat4 CameraFPS::projectionMatrix(float aspectRatio) {
 glm::mat4 CameraFPS::viewProjectionMatrix(float aspectRatio) {
   return projectionMatrix(aspectRatio) * viewMatrix();
 }
+
+// Gribb and Hartmann: each plane is the last row of the matrix plus or minus
+// one of the others.
+Frustum::Frustum(const glm::mat4 &transPV) {
+  auto row = [&](int i) {
+    return glm::vec4(transPV[0][i], transPV[1][i], transPV[2][i],
+                     transPV[3][i]);
+  };
+  for (auto i = 0; i < 3; ++i) {
+    planes[2 * i] = row(3) + row(i);
+    planes[2 * i + 1] = row(3) - row(i);
+  }
+}
+
+bool Frustum::intersects(glm::vec3 min, glm::vec3 max) const {
+  for (auto &plane : planes) {
+    auto corner = glm::vec3(plane.x > 0 ? max.x : min.x,
+                            plane.y > 0 ? max.y : min.y,
+                            plane.z > 0 ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0)
+      return false;
+  }
+  return true;
+}
@@ -3,6 +3,7 @@
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
 
 struct CameraFPS {
   explicit CameraFPS(glm::vec3 pos);
@@ -20,4 +21,12 @@ struct CameraFPS {
   bool init;
 };
 
+// Clip volume of a view-projection matrix as six planes with inward normals.
+struct Frustum {
+  explicit Frustum(const glm::mat4 &transPV);
+  // Conservative: boxes near a corner of the frustum may pass while outside.
+  bool intersects(glm::vec3 min, glm::vec3 max) const;
+  glm::vec4 planes[6];
+};
+
 #endif // SURFACES_CAMERA_HPP
@@ -1,17 +1,27 @@
 #include "canvas.hpp"
+#include "assets.hpp"
 
 std::pair<GLFW, Window> canvasNoCallback(int width, int height) {
   auto glfw = GLFW();
   glfw.xhintContextVersion(3, 3);
   glfw.windowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-  auto icon = Image::load("assets/icon.png");
-  auto iconMeta = new GLFWimage{icon.width, icon.height,
-                                icon.data}; // TODO don't leak memory
   auto window = Window{width, height, "Surfaces", nullptr, nullptr};
   window.makeContextCurrent();
-  window.setWindowIcon(*iconMeta);
   window.setInputMode(GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  loadGLAD();
+  loadGLAD((GLADloadproc)glfwGetProcAddress);
+  // The icon is decoded off this thread when startup assets are loading, and
+  // GLFW copies the pixels, so they need not outlive the call.
+  auto iconPath = std::string("assets/icon.png");
+  if (assets != nullptr) {
+    auto &icon = assets->loadedImage(iconPath);
+    auto iconMeta = GLFWimage{icon.width, icon.height, icon.data};
+    window.setWindowIcon(iconMeta);
+  } else {
+    auto icon = Image::load(iconPath);
+    auto iconMeta = GLFWimage{icon.width, icon.height, icon.data};
+    window.setWindowIcon(iconMeta);
+    icon.free();
+  }
   glViewport(0, 0, width, height);
   glEnable(GL_DEPTH_TEST);
   return {glfw, window};
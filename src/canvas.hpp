@@ -1,11 +1,13 @@
 #ifndef SURFACES_CANVAS_HPP
 #define SURFACES_CANVAS_HPP
 
-#include "camera.hpp"
 #include "xgl.hpp"
+#include <vector>
 
 std::pair<GLFW, Window> canvasNoCallback(int width, int height);
-template <ScreenInfo *screen, CameraFPS *camera>
+// Cursor positions are queued in cursor for the main loop to hand to the
+// camera, so they can be recorded and replayed with the rest of the input.
+template <ScreenInfo *screen, std::vector<glm::vec2> *cursor>
 std::pair<GLFW, Window> canvas() {
   auto [glfw, window] = canvasNoCallback(screen->width, screen->height);
   window.onFramebufferSize([](GLFWwindow *, int width, int height) {
@@ -14,7 +16,7 @@ std::pair<GLFW, Window> canvas() {
     screen->height = height;
   });
   window.onCursorPos([](GLFWwindow *, double x, double y) {
-    camera->handleCursorPos((float)x, (float)y);
+    cursor->emplace_back((float)x, (float)y);
   });
   return {glfw, window};
 }
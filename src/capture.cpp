@@ -0,0 +1,204 @@
+#include "capture.hpp"
+#include "lg.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+static double millisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+static bool endsWith(const std::string &text, const std::string &suffix) {
+  return text.size() >= suffix.size() and
+         text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Capture::Capture(const std::string &path, int width, int height)
+    : issued(0), stalls(0), renderMs(0.0), copyMs(0.0), maxMs(0.0),
+      writeMs(0.0),
+      path(path), stream(endsWith(path, ".rgb")), width(width),
+      height(height), slots(), next(0), oldest(0), taken(0), file(),
+      row(3 * width), mutex(), changed(), queue(), spare(), stopping(false),
+      writer() {
+  if (stream) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+  } else {
+    auto error = std::error_code();
+    std::filesystem::create_directories(path, error);
+  }
+  if ((stream and not file) or
+      (not stream and not std::filesystem::is_directory(path))) {
+    lg.error("failed to open capture ", path, "\n");
+    std::exit(1);
+  }
+  for (auto &slot : slots) {
+    slot.pbo.bindBuffer(GL_PIXEL_PACK_BUFFER);
+    glBufferData(GL_PIXEL_PACK_BUFFER, 4 * width * height, nullptr,
+                 GL_STREAM_READ);
+    slot.fence = nullptr;
+  }
+  slots[0].pbo.unbind(GL_PIXEL_PACK_BUFFER);
+  writer = std::thread([this] { write(); });
+}
+
+Capture::~Capture() {
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (writer.joinable())
+    writer.join();
+}
+
+void Capture::frame() {
+  auto start = Clock::now();
+  while (take(false))
+    ;
+  auto &slot = slots[next];
+  if (slot.fence != nullptr) {
+    ++stalls;
+    take(true);
+  }
+  xbindDefaultFramebuffer(GL_READ_FRAMEBUFFER);
+  slot.pbo.bindBuffer(GL_PIXEL_PACK_BUFFER);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  slot.pbo.unbind(GL_PIXEL_PACK_BUFFER);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  next = (next + 1) % slotCount;
+  ++issued;
+  auto ms = millisecondsSince(start);
+  renderMs += ms;
+  maxMs = std::max(maxMs, ms);
+}
+
+// Hands the oldest readback in flight to the writer if it has finished, or,
+// with block, once it has. The copy out of the mapped buffer is the one
+// per-frame cost the render thread cannot avoid.
+bool Capture::take(bool block) {
+  auto &slot = slots[oldest];
+  if (slot.fence == nullptr)
+    return false;
+  auto status = glClientWaitSync(slot.fence, 0, 0);
+  while (block and status == GL_TIMEOUT_EXPIRED)
+    status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                              1000000000);
+  if (status == GL_TIMEOUT_EXPIRED)
+    return false;
+  if (status == GL_WAIT_FAILED) {
+    lg.error("capture readback failed\n");
+    std::exit(1);
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+  oldest = (oldest + 1) % slotCount;
+  auto pixels = Pixels{taken++, {}};
+  {
+    auto lock = std::unique_lock<std::mutex>(mutex);
+    if ((int)queue.size() >= queueLimit)
+      ++stalls;
+    changed.wait(lock, [this] { return (int)queue.size() < queueLimit; });
+    if (not spare.empty()) {
+      pixels.rgba = std::move(spare.back());
+      spare.pop_back();
+    }
+  }
+  pixels.rgba.resize(4 * width * height);
+  auto start = Clock::now();
+  slot.pbo.bindBuffer(GL_PIXEL_PACK_BUFFER);
+  auto mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * width * height,
+                                 GL_MAP_READ_BIT);
+  if (mapped == nullptr) {
+    lg.error("capture readback could not be mapped\n");
+    std::exit(1);
+  }
+  memcpy(pixels.rgba.data(), mapped, pixels.rgba.size());
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  slot.pbo.unbind(GL_PIXEL_PACK_BUFFER);
+  copyMs += millisecondsSince(start);
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    queue.push_back(std::move(pixels));
+  }
+  changed.notify_all();
+  return true;
+}
+
+// The writer drains the queue before it stops.
+void Capture::finish() {
+  while (take(true))
+    ;
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  if (writer.joinable())
+    writer.join();
+}
+
+void Capture::write() {
+  profileThread("capture");
+  while (true) {
+    auto pixels = Pixels();
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex);
+      changed.wait(lock, [this] { return stopping or not queue.empty(); });
+      if (queue.empty())
+        return;
+      pixels = std::move(queue.front());
+      queue.pop_front();
+    }
+    auto start = Clock::now();
+    {
+      auto scope = ProfileScope("encode");
+      encode(pixels);
+    }
+    writeMs += millisecondsSince(start);
+    {
+      auto lock = std::lock_guard<std::mutex>(mutex);
+      spare.push_back(std::move(pixels.rgba));
+    }
+    changed.notify_all();
+  }
+}
+
+// GL rows run bottom up, image rows top down, and the alpha is dropped.
+void Capture::encode(const Pixels &pixels) {
+  auto image = std::ofstream();
+  auto &out = stream ? file : image;
+  if (not stream) {
+    auto name = std::ostringstream();
+    name << path << "/capture_" << std::setw(5) << std::setfill('0')
+         << pixels.frame << ".ppm";
+    image.open(name.str(), std::ios::binary | std::ios::trunc);
+    image << "P6\n" << width << " " << height << "\n255\n";
+  }
+  for (auto y = height - 1; y >= 0; --y) {
+    auto source = &pixels.rgba[4 * width * y];
+    for (auto x = 0; x < width; ++x)
+      memcpy(&row[3 * x], &source[4 * x], 3);
+    out.write((const char *)row.data(), row.size());
+  }
+  if (not out) {
+    lg.error("failed to write capture frame ", pixels.frame, "\n");
+    std::exit(1);
+  }
+}
+
+void Capture::report() const {
+  if (issued == 0)
+    return;
+  lg.info("capture: ", issued, " frames of ", width, "x", height, " to ", path,
+          ", ", renderMs / issued, " ms per frame on the render thread (max ",
+          maxMs, ", copying ", copyMs / issued, "), ",
+          taken > 0 ? writeMs / taken : 0.0, " ms encoding per frame, ",
+          stalls, " stalls\n");
+}
@@ -0,0 +1,72 @@
+#ifndef SURFACES_CAPTURE_HPP
+#define SURFACES_CAPTURE_HPP
+
+#include "xgl.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records finished frames without stalling the pipeline. Each frame is read
+// back into the next of a ring of pixel pack buffers, and a buffer is only
+// mapped once its fence has passed, normally a frame or two later. The
+// pixels then go to a writer thread that encodes them. A path ending in
+// ".rgb" gets one raw RGB24 stream, top row first, which ffmpeg reads with
+// -f rawvideo -pix_fmt rgb24 -s WxH. Any other path is a directory that gets
+// one PPM per frame. Frames keep the size given here; it is the window's at
+// the start, and a window resized later is not followed.
+//
+// The render thread only waits when the whole ring is still in flight or
+// the writer has fallen queueLimit frames behind; both count as stalls.
+struct Capture {
+  Capture(const std::string &path, int width, int height);
+  ~Capture();
+  Capture(const Capture &) = delete;
+  Capture &operator=(const Capture &) = delete;
+  // Starts reading back the default framebuffer, and hands finished
+  // readbacks to the writer.
+  void frame();
+  // Hands on every frame still in flight and waits for the writer to encode
+  // them. Needs the context current, so it is not left to the destructor.
+  void finish();
+  void report() const;
+  int issued;      // frames read back
+  int stalls;      // waits on the GPU or the writer
+  double renderMs; // render thread time in frame()
+  double copyMs;   // the part of it spent copying out of mapped buffers
+  double maxMs;    // longest frame()
+  double writeMs;  // writer thread time spent encoding
+
+private:
+  struct Slot {
+    VBO pbo;
+    GLsync fence; // null while the slot is free
+  };
+  struct Pixels {
+    int frame;
+    std::vector<unsigned char> rgba;
+  };
+  static const int slotCount = 3;
+  static const int queueLimit = 4;
+  bool take(bool block);
+  void write();
+  void encode(const Pixels &pixels);
+  std::string path;
+  bool stream;
+  int width, height;
+  Slot slots[slotCount];
+  int next, oldest, taken;
+  std::ofstream file;
+  std::vector<unsigned char> row;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::deque<Pixels> queue;
+  std::vector<std::vector<unsigned char>> spare;
+  bool stopping;
+  std::thread writer;
+};
+
+#endif // SURFACES_CAPTURE_HPP
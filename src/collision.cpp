@@ -0,0 +1,219 @@
+#include "collision.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <glm/glm.hpp>
+
+const long long RaftCollider::emptyKey = LLONG_MIN;
+
+static long long cellKey(int x, int z) {
+  return (long long)((unsigned long long)(unsigned)x << 32 | (unsigned)z);
+}
+
+// Half extents along x, y and z of a raft's bounding box.
+static glm::vec3 halfExtents(const glm::vec3 &scale, float rotation) {
+  auto c = std::abs(cosf(rotation)), s = std::abs(sinf(rotation));
+  return {scale.x / 2, s * scale.z / 2 + c * scale.y / 2,
+          c * scale.z / 2 + s * scale.y / 2};
+}
+
+RaftCollider::RaftCollider(float cellSize)
+    : stats(), restitution(0.2f), requestedCellSize(cellSize),
+      cellSize(cellSize), usedSlots(0) {}
+
+void RaftCollider::resize(const std::vector<glm::vec3> &scale) {
+  auto n = (int)scale.size();
+  cellSize = requestedCellSize;
+  for (auto &s : scale)
+    cellSize = std::max({cellSize, s.x, std::sqrt(s.z * s.z + s.y * s.y)});
+  auto capacity = 64;
+  while (capacity < 2 * cellsPerRaft * n)
+    capacity *= 2;
+  table.assign(capacity, {emptyKey, -1});
+  usedSlots = 0;
+  ranges.assign(n, {1, 1, 0, 0});
+  extents.assign(n, glm::vec3(0.0f));
+  entryNext.assign(cellsPerRaft * n, -1);
+  entryPrev.assign(cellsPerRaft * n, -1);
+  entrySlot.assign(cellsPerRaft * n, -1);
+  pairs.reserve(8 * n);
+}
+
+void RaftCollider::step(std::vector<glm::vec3> &position,
+                        std::vector<glm::vec2> &velocity,
+                        const std::vector<glm::vec3> &scale,
+                        const std::vector<float> &rotation,
+                        const std::vector<float> &mass) {
+  auto start = std::chrono::steady_clock::now();
+  stats = CollisionStats();
+  for (auto i = 0; i < (int)position.size(); ++i) {
+    extents[i] = halfExtents(scale[i], rotation[i]);
+    auto range = cellsOf(position[i], extents[i]);
+    auto &old = ranges[i];
+    if (range.x0 != old.x0 or range.z0 != old.z0 or range.x1 != old.x1 or
+        range.z1 != old.z1) {
+      if (4 * (usedSlots + cellsPerRaft) > 3 * (int)table.size())
+        rebuildTable();
+      unlink(i);
+      link(i, range);
+      ++stats.rebinned;
+    }
+  }
+  broadphase(position);
+  auto middle = std::chrono::steady_clock::now();
+  for (auto [i, j] : pairs)
+    if (narrowphase(i, j, position, velocity, scale, rotation, mass))
+      ++stats.contacts;
+  auto end = std::chrono::steady_clock::now();
+  stats.candidates = (int)pairs.size();
+  stats.broadphaseNs =
+      std::chrono::duration<double, std::nano>(middle - start).count();
+  stats.narrowphaseNs =
+      std::chrono::duration<double, std::nano>(end - middle).count();
+}
+
+RaftCollider::CellRange RaftCollider::cellsOf(const glm::vec3 &position,
+                                              const glm::vec3 &extent) const {
+  // Diverged rafts are left out of the grid rather than hashed to garbage.
+  if (not std::isfinite(position.x) or not std::isfinite(position.z))
+    return {1, 1, 0, 0};
+  return {(int)std::floor((position.x - extent.x) / cellSize),
+          (int)std::floor((position.z - extent.z) / cellSize),
+          (int)std::floor((position.x + extent.x) / cellSize),
+          (int)std::floor((position.z + extent.z) / cellSize)};
+}
+
+void RaftCollider::link(int raft, CellRange range) {
+  auto entry = cellsPerRaft * raft;
+  for (auto x = range.x0; x <= range.x1; ++x) {
+    for (auto z = range.z0; z <= range.z1; ++z, ++entry) {
+      auto slot = findSlot(cellKey(x, z));
+      entrySlot[entry] = slot;
+      entryPrev[entry] = -1;
+      entryNext[entry] = table[slot].head;
+      if (table[slot].head != -1)
+        entryPrev[table[slot].head] = entry;
+      table[slot].head = entry;
+    }
+  }
+  ranges[raft] = range;
+}
+
+void RaftCollider::unlink(int raft) {
+  for (auto k = 0; k < cellsPerRaft; ++k) {
+    auto entry = cellsPerRaft * raft + k;
+    auto slot = entrySlot[entry];
+    if (slot == -1)
+      continue;
+    if (entryPrev[entry] != -1)
+      entryNext[entryPrev[entry]] = entryNext[entry];
+    else
+      table[slot].head = entryNext[entry];
+    if (entryNext[entry] != -1)
+      entryPrev[entryNext[entry]] = entryPrev[entry];
+    entrySlot[entry] = -1;
+  }
+}
+
+// Open addressing with linear probing. Cells that empty out keep their slot
+// until step() calls rebuildTable() to keep the table at most three quarters
+// full. Cells next to each other along z hash to neighbouring slots, so the
+// broadphase walks the table roughly in order instead of missing the cache on
+// every cell.
+int RaftCollider::findSlot(long long key) {
+  auto mask = (int)table.size() - 1;
+  auto x = (unsigned)(key >> 32), z = (unsigned)key;
+  auto slot = (int)((x * 0x9E3779B1u + z) & mask);
+  while (table[slot].key != key and table[slot].key != emptyKey)
+    slot = (slot + 1) & mask;
+  if (table[slot].key == emptyKey) {
+    table[slot].key = key;
+    ++usedSlots;
+  }
+  return slot;
+}
+
+void RaftCollider::rebuildTable() {
+  std::fill(table.begin(), table.end(), Slot{emptyKey, -1});
+  std::fill(entrySlot.begin(), entrySlot.end(), -1);
+  usedSlots = 0;
+  for (auto i = 0; i < (int)ranges.size(); ++i)
+    link(i, ranges[i]);
+}
+
+void RaftCollider::broadphase(const std::vector<glm::vec3> &position) {
+  pairs.clear();
+  for (auto i = 0; i < (int)position.size(); ++i) {
+    auto &ri = ranges[i];
+    for (auto k = 0; k < cellsPerRaft; ++k) {
+      auto slot = entrySlot[cellsPerRaft * i + k];
+      if (slot == -1)
+        continue;
+      auto cellX = (int)(table[slot].key >> 32);
+      auto cellZ = (int)(table[slot].key & 0xffffffff);
+      for (auto entry = table[slot].head; entry != -1;
+           entry = entryNext[entry]) {
+        auto j = entry / cellsPerRaft;
+        if (j <= i)
+          continue;
+        // Rafts sharing several cells are paired only in the first of them.
+        auto &rj = ranges[j];
+        if (std::max(ri.x0, rj.x0) != cellX or std::max(ri.z0, rj.z0) != cellZ)
+          continue;
+        auto gap = glm::abs(position[j] - position[i]) - extents[i] - extents[j];
+        if (gap.x < 0 and gap.y < 0 and gap.z < 0)
+          pairs.emplace_back(i, j);
+      }
+    }
+  }
+}
+
+// Separating axis test between the two rafts' rectangles in the y-z plane,
+// with points written as (z, y) like the rest of the physics.
+bool RaftCollider::narrowphase(int i, int j, std::vector<glm::vec3> &position,
+                               std::vector<glm::vec2> &velocity,
+                               const std::vector<glm::vec3> &scale,
+                               const std::vector<float> &rotation,
+                               const std::vector<float> &mass) {
+  glm::vec2 axes[2][2];
+  glm::vec2 halves[2];
+  int rafts[2] = {i, j};
+  for (auto k = 0; k < 2; ++k) {
+    auto direction = glm::vec2(cosf(rotation[rafts[k]]), sinf(rotation[rafts[k]]));
+    axes[k][0] = direction;
+    axes[k][1] = glm::vec2(-direction.y, direction.x);
+    halves[k] = glm::vec2(scale[rafts[k]].z / 2, scale[rafts[k]].y / 2);
+  }
+  auto offset = glm::vec2(position[j].z - position[i].z,
+                          position[j].y - position[i].y);
+  auto depth = INFINITY;
+  auto normal = glm::vec2(0.0f, 1.0f);
+  for (auto &boxAxes : axes) {
+    for (auto axis : boxAxes) {
+      auto reach = 0.0f;
+      for (auto k = 0; k < 2; ++k)
+        reach += halves[k].x * std::abs(glm::dot(axes[k][0], axis)) +
+                 halves[k].y * std::abs(glm::dot(axes[k][1], axis));
+      auto distance = glm::dot(offset, axis);
+      auto overlap = reach - std::abs(distance);
+      if (overlap <= 0.0f)
+        return false;
+      if (overlap < depth) {
+        depth = overlap;
+        normal = distance < 0.0f ? -axis : axis;
+      }
+    }
+  }
+  auto inverseI = 1.0f / mass[i], inverseJ = 1.0f / mass[j];
+  auto correction = normal * depth / (inverseI + inverseJ);
+  position[i] -= glm::vec3(0.0f, correction.y, correction.x) * inverseI;
+  position[j] += glm::vec3(0.0f, correction.y, correction.x) * inverseJ;
+  auto approach = glm::dot(velocity[j] - velocity[i], normal);
+  if (approach < 0.0f) {
+    auto impulse = -(1.0f + restitution) * approach / (inverseI + inverseJ);
+    velocity[i] -= impulse * inverseI * normal;
+    velocity[j] += impulse * inverseJ * normal;
+  }
+  return true;
+}
@@ -0,0 +1,70 @@
+#ifndef SURFACES_COLLISION_HPP
+#define SURFACES_COLLISION_HPP
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <utility>
+#include <vector>
+
+struct CollisionStats {
+  int rebinned;   // rafts whose grid cells changed this step
+  int candidates; // broadphase pairs whose bounding boxes overlap
+  int contacts;   // candidates the narrowphase found touching and separated
+  double broadphaseNs;
+  double narrowphaseNs;
+};
+
+// Raft-raft collisions for RaftWorld. The broadphase is a uniform grid over
+// the horizontal plane, stored as a spatial hash whose cells hold intrusive
+// lists of rafts. Each step only rafts whose bounding box moved into other
+// cells are relinked, and candidate pairs come from rafts sharing a cell, so
+// the cost grows with the number of rafts rather than its square. The
+// narrowphase treats each raft as the box it is drawn as; rafts only move in
+// the y-z plane, so overlapping boxes are pushed apart there and exchange an
+// impulse along the contact normal.
+//
+// Cells are at least as large as any raft can get across, so a raft covers at
+// most 2x2 of them. All storage is sized by resize(), which keeps step() free
+// of heap allocations.
+struct RaftCollider {
+  explicit RaftCollider(float cellSize);
+  void resize(const std::vector<glm::vec3> &scale);
+  void step(std::vector<glm::vec3> &position, std::vector<glm::vec2> &velocity,
+            const std::vector<glm::vec3> &scale,
+            const std::vector<float> &rotation,
+            const std::vector<float> &mass);
+  CollisionStats stats;
+  float restitution;
+
+private:
+  struct CellRange {
+    int x0, z0, x1, z1;
+  };
+  struct Slot {
+    long long key;
+    int head;
+  };
+  static const int cellsPerRaft = 4;
+  static const long long emptyKey;
+  CellRange cellsOf(const glm::vec3 &position, const glm::vec3 &extent) const;
+  void link(int raft, CellRange range);
+  void unlink(int raft);
+  int findSlot(long long key);
+  void rebuildTable();
+  void broadphase(const std::vector<glm::vec3> &position);
+  bool narrowphase(int i, int j, std::vector<glm::vec3> &position,
+                   std::vector<glm::vec2> &velocity,
+                   const std::vector<glm::vec3> &scale,
+                   const std::vector<float> &rotation,
+                   const std::vector<float> &mass);
+  float requestedCellSize;
+  float cellSize;
+  int usedSlots;
+  std::vector<Slot> table;
+  std::vector<CellRange> ranges;
+  std::vector<glm::vec3> extents;
+  std::vector<int> entryNext, entryPrev, entrySlot;
+  std::vector<std::pair<int, int>> pairs;
+};
+
+#endif // SURFACES_COLLISION_HPP
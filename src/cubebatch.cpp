@@ -0,0 +1,48 @@
+#include "cubebatch.hpp"
+#include <glm/gtc/type_ptr.hpp>
+
+// Per cube: the model matrix by columns, then the colour.
+static const int instanceFloats = 16 + 3;
+
+CubeBatch::CubeBatch(const std::string &vertName, const std::string &fragName,
+                     CubeVertices &cubev)
+    : vao(), instanceVbo(), shader(shaderProgramFromAsset(vertName, fragName)),
+      upv(shader.locateUniform("trans_pv")), instances(), drawn(0) {
+  vao.bind();
+  cubev.vbo.bindBuffer(GL_ARRAY_BUFFER);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+                        (void *)(0 * sizeof(float)));
+  glEnableVertexAttribArray(0);
+  instanceVbo.xbindAndBufferStream(nullptr, 0);
+  for (auto column = 0; column < 4; ++column) {
+    glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE,
+                          instanceFloats * sizeof(float),
+                          (void *)(4 * column * sizeof(float)));
+    glVertexAttribDivisor(1 + column, 1);
+    glEnableVertexAttribArray(1 + column);
+  }
+  glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE,
+                        instanceFloats * sizeof(float),
+                        (void *)(16 * sizeof(float)));
+  glVertexAttribDivisor(5, 1);
+  glEnableVertexAttribArray(5);
+}
+
+void CubeBatch::add(const glm::mat4 &model, glm::vec3 color) {
+  auto matrix = glm::value_ptr(model);
+  instances.insert(instances.end(), matrix, matrix + 16);
+  instances.insert(instances.end(), {color.x, color.y, color.z});
+}
+
+void CubeBatch::draw(const glm::mat4 &transPV) {
+  drawn = (int)instances.size() / instanceFloats;
+  if (drawn > 0) {
+    vao.bind();
+    shader.use();
+    upv = transPV;
+    instanceVbo.xbindAndBufferStream(instances.data(),
+                                     (unsigned)instances.size());
+    glDrawArraysInstanced(GL_TRIANGLES, 0, CubeVertices::vertexCount, drawn);
+  }
+  instances.clear();
+}
@@ -0,0 +1,27 @@
+#ifndef SURFACES_CUBEBATCH_HPP
+#define SURFACES_CUBEBATCH_HPP
+
+#include "models.hpp"
+#include "xgl.hpp"
+#include <glm/mat4x4.hpp>
+#include <vector>
+
+// Instanced renderer for everything drawn as a unit cube. Entities add() a
+// model matrix and a colour each frame. draw() streams the whole frame's
+// instances into one buffer and issues a single glDrawArraysInstanced,
+// however many cubes were added, then starts over. Each shader pair gets its
+// own batch.
+struct CubeBatch {
+  CubeBatch(const std::string &vertName, const std::string &fragName,
+            CubeVertices &cubev);
+  void add(const glm::mat4 &model, glm::vec3 color);
+  void draw(const glm::mat4 &transPV);
+  VAO vao;
+  VBO instanceVbo;
+  Program shader;
+  Uniform upv;
+  std::vector<float> instances;
+  int drawn; // cubes the last draw() submitted
+};
+
+#endif // SURFACES_CUBEBATCH_HPP
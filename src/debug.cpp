@@ -1,34 +1,41 @@
-#include <utility>
-
 #include "debug.hpp"
-#include <glm/gtc/matrix_transform.hpp>
+#include "lg.hpp"
+#include <cstdlib>
+
+static const char *const categoryNames[] = {
+    "gravity",       "velocity",        "buoyancy",
+    "drag",          "part velocity",   "linear velocity",
+    "angular movement normal"};
+static_assert(sizeof(categoryNames) / sizeof(categoryNames[0]) ==
+              (int)DebugCategory::count);
+
+DebugCategory debugCategoryFromName(const std::string &name) {
+  for (auto i = 0; i < (int)DebugCategory::count; ++i)
+    if (name == categoryNames[i])
+      return (DebugCategory)i;
+  lg.error("unknown debug category ", name, "\n");
+  std::exit(1);
+}
 
-void Debug::point(const glm::vec3 &position, const std::string &name) {
-  assert(colorTable.count(name));
-  queuePoints.emplace_back(position, colorTable[name]);
+void Debug::point(const glm::vec3 &position, DebugCategory category) {
+  queuePoints.emplace_back(position, colors[(int)category]);
 }
 
-Debug::Debug(const std::string &vertName, const std::string &fragName,
-             CubeVertices &cubev, std::map<std::string, glm::vec3> colorTable)
-    : cubev(cubev), shader(shaderProgramFromAsset(vertName, fragName)),
-      upv(shader.locateUniform("trans_pv")),
-      umodel(shader.locateUniform("trans_model")),
-      ucolor(shader.locateUniform("color")), colorTable(std::move(colorTable)) {
+Debug::Debug(const std::map<std::string, glm::vec3> &colorTable)
+    : mask(0), colors(), queuePoints() {
+  for (auto &[name, color] : colorTable) {
+    auto category = (int)debugCategoryFromName(name);
+    colors[category] = color;
+    mask |= 1u << category;
+  }
 }
 
+// Clearing keeps the capacity, so once the queue has grown to a frame's worth
+// of points recording no longer allocates.
 void Debug::reset() { queuePoints.clear(); }
 
-void Debug::draw(const glm::mat4 &transPV) {
-  shader.use();
-  upv = transPV;
-  for (auto point : queuePoints) {
-    auto model = glm::mat4(1.0f);
-    model = glm::translate(model, point.first);
-    model = glm::scale(model, glm::vec3(0.5f));
-    umodel = model;
-    ucolor = point.second;
-    cubev.draw();
-  }
+const std::vector<std::pair<glm::vec3, glm::vec3>> &Debug::points() const {
+  return queuePoints;
 }
 
 Debug *debug = nullptr;
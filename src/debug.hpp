@@ -1,29 +1,72 @@
 #ifndef SURFACES_DEBUG_HPP
 #define SURFACES_DEBUG_HPP
 
-#include "models.hpp"
-#include "xgl.hpp"
 #include <glm/vec3.hpp>
 #include <map>
+#include <string>
 #include <vector>
 
+enum class DebugCategory {
+  gravity,
+  velocity,
+  buoyancy,
+  drag,
+  partVelocity,
+  linearVelocity,
+  angularMovementNormal,
+  count
+};
+
+// Categories compiled in, bit 1 << category for each DebugCategory. Builds
+// without NDEBUG keep them all. Release builds keep only the bits set in the
+// SURFACES_DEBUG_CATEGORIES bitmask, none by default, so F5 and
+// --debug-categories show nothing there unless CMake is configured with, say,
+// -DSURFACES_DEBUG_CATEGORIES=0x7f. Whatever debugging() guards for the
+// categories left out is compiled out.
+#ifndef SURFACES_DEBUG_CATEGORIES
+#ifdef NDEBUG
+#define SURFACES_DEBUG_CATEGORIES 0u
+#else
+#define SURFACES_DEBUG_CATEGORIES ~0u
+#endif
+#endif
+constexpr unsigned debugCompiledCategories = SURFACES_DEBUG_CATEGORIES;
+
+// Category names resolve to their ids once, when the colour table is built
+// or the command line is read, so recording a point involves no strings.
+DebugCategory debugCategoryFromName(const std::string &name);
+
 struct Debug {
-  Debug(const std::string &vertPath, const std::string &fragPath,
-        CubeVertices &cubev, std::map<std::string, glm::vec3> colorTable);
-  void point(const glm::vec3 &position, const std::string &name);
+  explicit Debug(const std::map<std::string, glm::vec3> &colorTable);
+  bool enabled(DebugCategory category) const {
+    return mask >> (int)category & 1u;
+  }
+  void point(const glm::vec3 &position, DebugCategory category);
   void reset();
-  void draw(const glm::mat4 &transPV);
+  const std::vector<std::pair<glm::vec3, glm::vec3>> &points() const;
+  // Categories recorded, one bit each; starts as those with a colour.
+  unsigned mask;
 
 private:
-  CubeVertices &cubev;
-  Program shader;
-  Uniform upv;
-  Uniform umodel;
-  Uniform ucolor;
-  std::map<std::string, glm::vec3> colorTable;
+  glm::vec3 colors[(int)DebugCategory::count];
   std::vector<std::pair<glm::vec3, glm::vec3>> queuePoints;
 };
 
+// Physics records force markers here when it is set; headless builds leave it
+// null and nothing is recorded.
 extern Debug *debug;
 
+// Whether points of the category are being recorded. Check it before working
+// out a point; for categories compiled out it is a constant false.
+inline bool debugging(DebugCategory category) {
+  return (debugCompiledCategories >> (int)category & 1u) and
+         debug != nullptr and debug->enabled(category);
+}
+
+// Whether any category is being recorded.
+inline bool debugging() {
+  return debugCompiledCategories != 0 and debug != nullptr and
+         (debug->mask & debugCompiledCategories) != 0;
+}
+
 #endif // SURFACES_DEBUG_HPP
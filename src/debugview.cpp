@@ -0,0 +1,16 @@
+#include "debugview.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+DebugView::DebugView(const std::string &vertName, const std::string &fragName,
+                     CubeVertices &cubev)
+    : batch(vertName, fragName, cubev) {}
+
+void DebugView::draw(const Debug &debug, const glm::mat4 &transPV) {
+  for (auto point : debug.points()) {
+    auto model = glm::mat4(1.0f);
+    model = glm::translate(model, point.first);
+    model = glm::scale(model, glm::vec3(0.5f));
+    batch.add(model, point.second);
+  }
+  batch.draw(transPV);
+}
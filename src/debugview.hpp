@@ -0,0 +1,18 @@
+#ifndef SURFACES_DEBUGVIEW_HPP
+#define SURFACES_DEBUGVIEW_HPP
+
+#include "cubebatch.hpp"
+#include "debug.hpp"
+
+// Draws every recorded debug point as a small coloured cube, all of them in
+// one instanced draw.
+struct DebugView {
+  DebugView(const std::string &vertPath, const std::string &fragPath,
+            CubeVertices &cubev);
+  void draw(const Debug &debug, const glm::mat4 &transPV);
+
+private:
+  CubeBatch batch;
+};
+
+#endif // SURFACES_DEBUGVIEW_HPP
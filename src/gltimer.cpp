@@ -0,0 +1,71 @@
+#include "gltimer.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+GLTimers::GLTimers()
+    : dropped(0), totals(), slots(), next(0), oldest(0), active(-1),
+      track(profileTrack("gpu")) {
+  for (auto &slot : slots) {
+    glGenQueries(1, &slot.query);
+    slot.pending = false;
+  }
+}
+
+GLTimers::Scope GLTimers::scope(const char *name) {
+  begin(name);
+  return Scope(*this);
+}
+
+void GLTimers::begin(const char *name) {
+  auto &slot = slots[next];
+  if (slot.pending) {
+    ++dropped;
+    return;
+  }
+  glBeginQuery(GL_TIME_ELAPSED, slot.query);
+  slot.name = name;
+  slot.issued = profileNow();
+  active = next;
+  next = (next + 1) % slotCount;
+}
+
+void GLTimers::end() {
+  if (active < 0)
+    return;
+  glEndQuery(GL_TIME_ELAPSED);
+  slots[active].pending = true;
+  active = -1;
+}
+
+// Slots are handed out and read back in the same order, so the first one not
+// ready yet ends the scan.
+void GLTimers::collect() {
+  while (slots[oldest].pending) {
+    auto &slot = slots[oldest];
+    auto available = 0;
+    glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (not available)
+      break;
+    auto elapsed = GLuint64(0);
+    glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &elapsed);
+    track->record(slot.name, slot.issued, slot.issued + (long long)elapsed);
+    auto total = std::find_if(
+        totals.begin(), totals.end(),
+        [&](const Total &entry) { return not strcmp(entry.name, slot.name); });
+    if (total == totals.end())
+      total = totals.insert(totals.end(), {slot.name, 0.0, 0});
+    total->ms += elapsed / 1e6;
+    ++total->count;
+    slot.pending = false;
+    oldest = (oldest + 1) % slotCount;
+  }
+}
+
+void GLTimers::report() const {
+  auto passes = std::ostringstream();
+  for (auto &total : totals)
+    passes << " " << total.name << " " << total.ms / total.count;
+  lg.info("gpu ms per pass:", passes.str(), " (", dropped, " dropped)\n");
+}
@@ -0,0 +1,55 @@
+#ifndef SURFACES_GLTIMER_HPP
+#define SURFACES_GLTIMER_HPP
+
+#include "profile.hpp"
+#include "xgl.hpp"
+#include <vector>
+
+// GPU time of render passes, measured with GL_TIME_ELAPSED queries and
+// recorded on a "gpu" profile track. Queries come from a ring and are read
+// back frames later, once the driver says their results are in, so nothing
+// waits on the GPU. A pass whose query is still in flight when its turn comes
+// round goes unmeasured and counts as dropped. GL only reports durations, so
+// each pass is put on the timeline at the CPU time it was issued.
+//
+// Passes may not nest.
+struct GLTimers {
+  GLTimers();
+  struct Scope {
+    explicit Scope(GLTimers &timers) : timers(timers) {}
+    ~Scope() { timers.end(); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    GLTimers &timers;
+  };
+  Scope scope(const char *name);
+  void begin(const char *name);
+  void end();
+  // Records every finished pass; call once a frame.
+  void collect();
+  // Logs the mean GPU time of each pass collected so far.
+  void report() const;
+  int dropped;
+  struct Total {
+    const char *name;
+    double ms;
+    int count;
+  };
+  std::vector<Total> totals; // per pass name, in order of first collection
+
+private:
+  struct Slot {
+    unsigned query;
+    const char *name;
+    long long issued;
+    bool pending;
+  };
+  static const int slotCount = 64;
+  Slot slots[slotCount];
+  int next;
+  int oldest;
+  int active;
+  ProfileTrack *track;
+};
+
+#endif // SURFACES_GLTIMER_HPP
@@ -1,6 +1,7 @@
 #include "inter.hpp"
 
-Inter::Inter(int width, int height) : texture(), rbo(), fbo() {
+Inter::Inter(int width, int height)
+    : width(width), height(height), texture(), rbo(), fbo() {
   texture.bind(GL_TEXTURE_2D);
   texture.image2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
                   GL_UNSIGNED_BYTE, nullptr);
@@ -21,6 +22,7 @@ Inter::Inter(int width, int height) : texture(), rbo(), fbo() {
 
 void Inter::bind() {
   fbo.bind(GL_FRAMEBUFFER);
+  glViewport(0, 0, width, height);
   glEnable(GL_DEPTH_TEST);
 }
 
@@ -28,3 +30,9 @@ void Inter::unbind() {
   glDisable(GL_DEPTH_TEST);
   fbo.unbind(GL_FRAMEBUFFER);
 }
+
+void Inter::free() {
+  fbo.free();
+  rbo.free();
+  texture.free();
+}
@@ -5,8 +5,11 @@
 
 struct Inter {
   Inter(int width, int height);
+  // Binds the framebuffer and sets the viewport to all of it.
   void bind();
   void unbind();
+  void free();
+  int width, height;
   Texture texture;
   RBO rbo;
   FBO fbo;
@@ -0,0 +1,115 @@
+#include "jobs.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+JobSystem::JobSystem(int threads, bool deterministic)
+    : deterministic(deterministic), threads(std::max(threads, 1)),
+      queues(new Queue[std::max(threads, 1)]), generation(0), stopping(false),
+      task(nullptr), context(nullptr), n(0), size(1), remaining(0) {
+  for (auto i = 1; i < this->threads; ++i)
+    workers.emplace_back(&JobSystem::worker, this, i);
+}
+
+JobSystem::~JobSystem() {
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : workers)
+    thread.join();
+}
+
+int JobSystem::threadCount() const { return threads; }
+
+bool JobSystem::isDeterministic() const { return deterministic; }
+
+int JobSystem::chunkSize(int n, int grain) const {
+  grain = std::max(grain, 1);
+  if (deterministic)
+    return grain;
+  // Otherwise aim for a few chunks per thread to amortize the queue traffic.
+  return std::max(grain, (n + 4 * threads - 1) / (4 * threads));
+}
+
+void JobSystem::run(int n, int grain, Task task, void *context) {
+  if (n <= 0)
+    return;
+  auto size = chunkSize(n, grain);
+  auto chunks = (n + size - 1) / size;
+  if (threads == 1 or chunks == 1) {
+    for (auto begin = 0; begin < n; begin += size)
+      task(context, begin, std::min(n, begin + size));
+    return;
+  }
+  {
+    auto lock = std::lock_guard<std::mutex>(mutex);
+    this->task = task;
+    this->context = context;
+    this->n = n;
+    this->size = size;
+    remaining.store(chunks, std::memory_order_relaxed);
+    for (auto i = 0; i < threads; ++i) {
+      auto queueLock = std::lock_guard<std::mutex>(queues[i].mutex);
+      queues[i].begin = (int)((long long)chunks * i / threads);
+      queues[i].end = (int)((long long)chunks * (i + 1) / threads);
+    }
+    ++generation;
+  }
+  wake.notify_all();
+  work(0);
+  while (remaining.load(std::memory_order_acquire) != 0)
+    std::this_thread::yield();
+}
+
+void JobSystem::worker(int index) {
+  auto seen = 0ull;
+  while (true) {
+    {
+      auto lock = std::unique_lock<std::mutex>(mutex);
+      wake.wait(lock, [&] { return stopping or generation != seen; });
+      if (stopping)
+        return;
+      seen = generation;
+    }
+    work(index);
+  }
+}
+
+void JobSystem::work(int index) {
+  auto chunk = 0;
+  while (pop(index, chunk) or steal(index, chunk)) {
+    auto begin = chunk * size;
+    task(context, begin, std::min(n, begin + size));
+    remaining.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+bool JobSystem::pop(int index, int &chunk) {
+  auto &queue = queues[index];
+  auto lock = std::lock_guard<std::mutex>(queue.mutex);
+  if (queue.begin == queue.end)
+    return false;
+  chunk = queue.begin++;
+  return true;
+}
+
+bool JobSystem::steal(int index, int &chunk) {
+  for (auto offset = 1; offset < threads; ++offset) {
+    auto &queue = queues[(index + offset) % threads];
+    auto lock = std::lock_guard<std::mutex>(queue.mutex);
+    if (queue.begin != queue.end) {
+      chunk = --queue.end;
+      return true;
+    }
+  }
+  return false;
+}
+
+int jobThreadsFromEnvironment() {
+  if (auto threads = std::getenv("SURFACES_THREADS"))
+    return std::max(std::atoi(threads), 1);
+  return std::max((int)std::thread::hardware_concurrency(), 1);
+}
+
+JobSystem *jobs = nullptr;
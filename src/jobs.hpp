@@ -0,0 +1,77 @@
+#ifndef SURFACES_JOBS_HPP
+#define SURFACES_JOBS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Small work-stealing thread pool for data-parallel loops. A parallelFor splits
+// [0, n) into chunks, deals them out to one queue per thread, and each thread
+// drains its own queue before stealing from the others. The calling thread
+// takes part as well, and nothing is allocated per call, so it is safe to use
+// under AllocationGuard.
+//
+// In deterministic mode chunk boundaries depend only on n and the grain, never
+// on the thread count, so per-chunk partial results combined in chunk order
+// come out bit-identical however many threads run them.
+struct JobSystem {
+  JobSystem(int threads, bool deterministic);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+  int threadCount() const;
+  bool isDeterministic() const;
+  int chunkSize(int n, int grain) const;
+  template <typename F> void parallelFor(int n, int grain, F &&fn) {
+    using Fn = std::remove_reference_t<F>;
+    run(n, grain,
+        [](void *context, int begin, int end) {
+          (*static_cast<Fn *>(context))(begin, end);
+        },
+        (void *)&fn);
+  }
+
+private:
+  using Task = void (*)(void *context, int begin, int end);
+  struct Queue {
+    std::mutex mutex;
+    int begin = 0, end = 0;
+  };
+  void run(int n, int grain, Task task, void *context);
+  void worker(int index);
+  void work(int index);
+  bool pop(int index, int &chunk);
+  bool steal(int index, int &chunk);
+  bool deterministic;
+  int threads;
+  std::unique_ptr<Queue[]> queues;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  unsigned long long generation;
+  bool stopping;
+  Task task;
+  void *context;
+  int n, size;
+  std::atomic<int> remaining;
+};
+
+// Thread count for the main binary: SURFACES_THREADS if set, otherwise every
+// hardware thread.
+int jobThreadsFromEnvironment();
+
+// Loops run through this pool when it is set and serially otherwise.
+extern JobSystem *jobs;
+
+template <typename F> void parallelFor(int n, int grain, F &&fn) {
+  if (jobs != nullptr)
+    jobs->parallelFor(n, grain, fn);
+  else if (n > 0)
+    fn(0, n);
+}
+
+#endif // SURFACES_JOBS_HPP
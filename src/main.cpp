@@ -1,99 +1,433 @@
+#include "alloc.hpp"
+#include "assets.hpp"
+#include "bloom.hpp"
 #include "camera.hpp"
 #include "canvas.hpp"
+#include "capture.hpp"
+#include "cubebatch.hpp"
 #include "debug.hpp"
+#include "debugview.hpp"
+#include "gltimer.hpp"
 #include "inter.hpp"
+#include "jobs.hpp"
 #include "lg.hpp"
 #include "math.hpp"
 #include "models.hpp"
+#include "ocean.hpp"
+#include "offscreen.hpp"
+#include "options.hpp"
 #include "physics.hpp"
+#include "profile.hpp"
+#include "programcache.hpp"
 #include "raft.hpp"
+#include "record.hpp"
+#include "resolution.hpp"
 #include "screenbuffer.hpp"
 #include "sun.hpp"
 #include "time.hpp"
 #include "water.hpp"
 #include "xgl.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <glm/gtc/matrix_transform.hpp>
+#include <iomanip>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
 
 auto monitor = ScreenInfo{1600, 800};
 auto camera = CameraFPS({470.0f, 5.0f, 500.0f}); // NOLINT(cert-err58-cpp)
+auto cursorEvents = std::vector<glm::vec2>();     // NOLINT(cert-err58-cpp)
 
-int main() {
-  auto [glfw, window] = canvas<&monitor, &camera>();
-  auto aspectRatio = monitor.aspectRatio();
-  auto time = Time();
+// The GLFW key behind each InputKey.
+static const int inputKeys[] = {
+    GLFW_KEY_ESCAPE, GLFW_KEY_SPACE, GLFW_KEY_F3, GLFW_KEY_F4, GLFW_KEY_F5,
+    GLFW_KEY_LEFT_ALT, GLFW_KEY_F6, GLFW_KEY_D, GLFW_KEY_A, GLFW_KEY_E,
+    GLFW_KEY_Q, GLFW_KEY_S, GLFW_KEY_W};
+static_assert(sizeof(inputKeys) / sizeof(*inputKeys) == (int)InputKey::count);
+
+static void pollInput(GLFW &glfw, Window &window, InputFrame &input) {
+  input.time = (float)glfw.time();
+  input.keys = 0;
+  for (auto i = 0; i < (int)InputKey::count; ++i)
+    if (window.getKey(inputKeys[i]) == GLFW_PRESS)
+      input.keys |= 1u << i;
+  input.cursor.swap(cursorEvents);
+  cursorEvents.clear();
+}
+
+// Offscreen frames run at a fixed 60 Hz with no keys held, while the camera
+// circles the raft once over the run.
+static void scriptedInput(InputFrame &input, int frame) {
+  input.time = frame / 60.0f;
+  input.keys = 0;
+  input.cursor.clear();
+}
+
+static void cameraPath(CameraFPS &camera, int frame, int frames) {
+  auto center = glm::vec3(505.0f, 8.0f, 505.0f);
+  auto angle = 2 * (float)M_PI * frame / frames;
+  camera.pos = center + glm::vec3(45.0f * cosf(angle), 12.0f,
+                                  45.0f * sinf(angle));
+  camera.front = glm::normalize(center - camera.pos);
+}
+
+// Comma separated frame numbers, as in "0,30,59".
+static std::set<int> frameList(const std::string &list) {
+  auto frames = std::set<int>();
+  auto begin = (size_t)0;
+  while (begin < list.size()) {
+    auto end = std::min(list.find(',', begin), list.size());
+    frames.insert(std::atoi(list.substr(begin, end - begin).c_str()));
+    begin = end + 1;
+  }
+  return frames;
+}
+
+// Every bit of every raft's state, for checking a replay against its
+// recording.
+static unsigned long long physicsChecksum(const Raft &raft,
+                                          const RaftFleet *fleet) {
+  auto &physics = raft.physics;
+  auto hash = hashStart;
+  hash = hashFloats(hash, &physics.position.x, 3);
+  hash = hashFloats(hash, &physics.velocity.x, 2);
+  hash = hashFloats(hash, &physics.rotation, 1);
+  hash = hashFloats(hash, &physics.angularVelocity, 1);
+  if (fleet != nullptr) {
+    auto &world = fleet->world;
+    hash = hashFloats(hash, &world.position[0].x, 3 * world.size());
+    hash = hashFloats(hash, &world.velocity[0].x, 2 * world.size());
+    hash = hashFloats(hash, world.rotation.data(), world.size());
+    hash = hashFloats(hash, world.angularVelocity.data(), world.size());
+  }
+  return hash;
+}
+
+int main(int argc, char **argv) {
+  auto options = parseOptions(argc, argv);
+  // A replay runs the scene it was recorded in, whatever the command line
+  // says.
+  auto player = std::unique_ptr<InputPlayer>();
+  if (options.replay != nullptr) {
+    player = std::make_unique<InputPlayer>(options.replay);
+    auto &settings = player->settings;
+    options.physicsRate = settings.physicsRate;
+    options.maxSubsteps = settings.maxSubsteps;
+    options.ocean = settings.ocean;
+    options.jonswap = settings.jonswap;
+    options.rafts = settings.rafts;
+  }
+  profileThread("main");
+  auto jobSystem = JobSystem(options.threads, true);
+  ::jobs = &jobSystem;
+
+  // Shader sources, the icon and the water mesh load on worker threads while
+  // the window opens; the GL objects are then made here in one batch.
+  auto startup = Assets();
+  ::assets = &startup;
+  startup.program("screen", "screen");
+  if (options.bloomLevels > 0) {
+    startup.program("screen", "bloom_extract");
+    startup.program("screen", "bloom_down");
+    startup.program("screen", "bloom_up");
+  }
+  startup.program("standard", "debug_point");
+  startup.program("standard", "sun");
+  startup.program("water", "water");
+  startup.program("standard", "raft");
+  startup.image("assets/icon.png");
+  auto waterPatch = std::optional<WaterPatch>();
+  startup.task("water patch", [&waterPatch] { waterPatch.emplace(16); });
+  startup.start();
+  auto offscreen = std::unique_ptr<Offscreen>();
+  auto windowed = std::optional<std::pair<GLFW, Window>>();
+  if (options.offscreen > 0)
+    offscreen = std::make_unique<Offscreen>(monitor.width, monitor.height);
+  else
+    windowed = canvas<&monitor, &cursorEvents>();
+  auto glfw = windowed ? &windowed->first : nullptr;
+  auto window = windowed ? &windowed->second : nullptr;
+  startup.mark(offscreen ? "context" : "window");
+  auto binaries = std::unique_ptr<ProgramCache>();
+  if (*options.programCache) {
+    binaries = std::make_unique<ProgramCache>(options.programCache);
+    ::programCache = binaries.get();
+  }
+  startup.wait();
+  startup.mark("loading");
+  startup.build();
+  startup.mark("shaders");
+
+  auto time = Time(options.physicsRate, options.maxSubsteps);
   auto paused = ToggleButton(false);
   auto transparent = ToggleButton(false);
   auto wireframe = ToggleButton(false);
   auto physicsdebug = ToggleButton(false);
   auto slowmo = ToggleButton(false);
+  auto trace = ToggleButton(false);
+  auto tracePath = options.trace != nullptr ? options.trace : "trace.json";
   auto cubeVertices = CubeVertices();
   auto quadVertices = QuadVertices();
   auto screen = Screenbuffer("screen", "screen", quadVertices);
-  auto screenExtract =
-      Screenbuffer("screen", "screen_bloom_extract", quadVertices);
-  auto screenBlur = Screenbuffer("screen", "screen_bloom_blur", quadVertices);
-  auto inter = Inter(monitor.width, monitor.height);
-  auto globalDebug = Debug("debug_point", "debug_point", cubeVertices,
-                           {
-                               {"gravity", {1, 0, 0}},
-                               {"velocity", {0, 0, 0}},
-                               {"buoyancy", {0, 0, 1}},
-                               {"drag", {0, 1, 0}},
-                               {"part velocity", {.5, .5, .5}},
-                               {"linear velocity", {1, 1, 1}},
-                               {"angular movement normal", {1, 0.2, 1}},
-                           });
-  ::debug = &globalDebug;
-
-  auto sun = Sun({550.0f, 30.0f, 550.0f}, {10.0f, 10.0f, 10.0f}, "standard",
-                 "sun", cubeVertices);
-  auto water = Water(1000, 1000, "water", "water", sun.position);
-  auto raft = Raft({500.0f, 10.0f, 500.0f}, wood, {10.0f, 0.5f, 10.0f}, 8,
-                   "standard", "raft", cubeVertices);
-
-  while (not window.shouldClose()) {
+  auto resolution = Resolution(options.resolutionScale, options.gpuBudget);
+  auto bloom = std::unique_ptr<Bloom>();
+  if (options.bloomLevels > 0)
+    bloom = std::make_unique<Bloom>(monitor.width, monitor.height,
+                                    options.bloomLevels, quadVertices);
+  auto capture = std::unique_ptr<Capture>();
+  if (options.capture != nullptr)
+    capture = std::make_unique<Capture>(options.capture, monitor.width,
+                                        monitor.height);
+  auto globalDebug = Debug({
+      {"gravity", {1, 0, 0}},
+      {"velocity", {0, 0, 0}},
+      {"buoyancy", {0, 0, 1}},
+      {"drag", {0, 1, 0}},
+      {"part velocity", {.5, .5, .5}},
+      {"linear velocity", {1, 1, 1}},
+      {"angular movement normal", {1, 0.2, 1}},
+  });
+  globalDebug.mask &= options.debugCategories;
+  auto debugView = DebugView("standard", "debug_point", cubeVertices);
+
+  auto sun = Sun({550.0f, 30.0f, 550.0f}, {10.0f, 10.0f, 10.0f});
+  auto sunBatch = CubeBatch("standard", "sun", cubeVertices);
+  auto water =
+      Water(std::move(*waterPatch), 6, 1.0f, "water", "water", sun.position);
+  auto oceanSurface = std::unique_ptr<Ocean>();
+  if (options.ocean) {
+    auto settings = OceanSettings();
+    settings.jonswap = options.jonswap;
+    oceanSurface = std::make_unique<Ocean>(settings);
+    ::ocean = oceanSurface.get();
+  }
+  auto raft = Raft({500.0f, 10.0f, 500.0f}, wood, {10.0f, 0.5f, 10.0f}, 8);
+  auto fleet = std::unique_ptr<RaftFleet>();
+  if (options.rafts > 0)
+    fleet = std::make_unique<RaftFleet>(options.rafts,
+                                        glm::vec3(520.0f, 10.0f, 520.0f),
+                                        15.0f, wood,
+                                        glm::vec3(10.0f, 0.5f, 10.0f), 8);
+  auto raftBatch = CubeBatch("standard", "raft", cubeVertices);
+  startup.mark("scene");
+  startup.report();
+  if (programCache != nullptr)
+    programCache->report();
+  ::assets = nullptr;
+
+  auto recorder = std::unique_ptr<InputRecorder>();
+  if (options.record != nullptr)
+    recorder = std::make_unique<InputRecorder>(
+        options.record,
+        InputSettings{options.physicsRate, options.maxSubsteps, options.ocean,
+                      options.jonswap, options.rafts});
+  auto input = InputFrame();
+  auto recordedChecksum = 0ull;
+  auto diverged = -1;
+  auto loopStart = std::chrono::steady_clock::now();
+  auto dumpFrames = frameList(options.dumpFrames);
+  if (not dumpFrames.empty())
+    std::filesystem::create_directories(options.dumpDir);
+  auto frameMs = std::vector<double>();
+  auto quit = false;
+  auto stepped = false; // the first substep, which may allocate, has run
+
+  auto callTotals = GLCallStats{0, 0};
+  auto gpuTimers = GLTimers();
+  auto frame = 0;
+  auto running = [&] {
+    return not quit and (offscreen ? frame < options.offscreen
+                                   : not window->shouldClose());
+  };
+  for (; running(); ++frame) {
+    auto frameScope = ProfileScope("frame");
+    auto frameStart = std::chrono::steady_clock::now();
 
     // handle input
-    debug->reset();
-    time.handle(*paused, *slowmo, (float)glfw.time());
-    if (window.getKey(GLFW_KEY_ESCAPE) == GLFW_PRESS)
-      window.setShouldClose(true);
-    paused.update(window.getKey(GLFW_KEY_SPACE));
-    transparent.update(window.getKey(GLFW_KEY_F3));
-    wireframe.update(window.getKey(GLFW_KEY_F4));
-    physicsdebug.update(window.getKey(GLFW_KEY_F5));
-    slowmo.update(window.getKey(GLFW_KEY_LEFT_ALT));
-    camera.handleKeyboard(window.xkeyjoy(GLFW_KEY_D, GLFW_KEY_A),
-                          window.xkeyjoy(GLFW_KEY_E, GLFW_KEY_Q),
-                          window.xkeyjoy(GLFW_KEY_S, GLFW_KEY_W),
-                          time.camera.delta);
-    raft.update(time.physics.delta, time.physics.current);
+    {
+      auto scope = ProfileScope("input");
+      globalDebug.reset();
+      if (player) {
+        if (not player->next(input, recordedChecksum))
+          break;
+        cursorEvents.clear();
+      } else if (offscreen) {
+        scriptedInput(input, frame);
+      } else {
+        pollInput(*glfw, *window, input);
+      }
+      time.handle(*paused, *slowmo, input.time);
+      if (input.key(InputKey::escape))
+        quit = true;
+      paused.update(input.key(InputKey::pause));
+      transparent.update(input.key(InputKey::transparent));
+      wireframe.update(input.key(InputKey::wireframe));
+      physicsdebug.update(input.key(InputKey::physicsDebug));
+      slowmo.update(input.key(InputKey::slowmo));
+      if (trace.update(input.key(InputKey::trace)))
+        profileWriteTrace(tracePath);
+      ::debug = *physicsdebug ? &globalDebug : nullptr;
+      for (auto position : input.cursor)
+        camera.handleCursorPos(position.x, position.y);
+      camera.handleKeyboard(input.axis(InputKey::right, InputKey::left),
+                            input.axis(InputKey::up, InputKey::down),
+                            input.axis(InputKey::backward, InputKey::forward),
+                            time.camera.delta);
+      if (offscreen and not player)
+        cameraPath(camera, frame, options.offscreen);
+    }
+    {
+      auto scope = ProfileScope("physics");
+      auto guard = AllocationGuard("physics step", stepped and not debugging());
+      for (auto i = 0; i < time.fixed.substeps; ++i) {
+        if (ocean != nullptr)
+          ocean->update(time.stepTime(i));
+        raft.update(time.fixed.step, time.stepTime(i));
+        if (fleet)
+          fleet->update(time.fixed.step, time.stepTime(i));
+      }
+      stepped = stepped or time.fixed.substeps > 0;
+    }
+    if (recorder)
+      recorder->frame(input, physicsChecksum(raft, fleet.get()));
+    if (player and diverged < 0 and
+        physicsChecksum(raft, fleet.get()) != recordedChecksum) {
+      diverged = frame;
+      lg.error("replay diverged from the recording at frame ", frame, "\n");
+    }
+    if (not options.render) {
+      if (glfw != nullptr)
+        glfw->pollEvents();
+      continue;
+    }
+    if (ocean != nullptr) {
+      auto scope = ProfileScope("ocean upload");
+      water.upload(*ocean);
+    }
 
     // render
 
-    auto transPV = camera.viewProjectionMatrix(aspectRatio);
+    glCalls = GLCallStats{0, 0};
+    auto transPV = camera.viewProjectionMatrix(monitor.aspectRatio());
 
+    auto &inter = resolution.target(monitor.width, monitor.height);
+    resolution.begin();
     inter.bind();
     xclear(rgb(0x00, 0x2b, 0x36), GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     if (*wireframe)
       glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    water.draw(time.physics.current, transPV, camera.pos, *transparent);
-    raft.draw(transPV);
+    {
+      auto scope = ProfileScope("water");
+      auto gpu = gpuTimers.scope("water");
+      water.draw(time.physics.current, transPV, camera.pos, *transparent);
+    }
+    {
+      auto scope = ProfileScope("raft");
+      auto gpu = gpuTimers.scope("raft");
+      raft.draw(raftBatch, time.fixed.alpha);
+      if (fleet)
+        fleet->draw(raftBatch, time.fixed.alpha);
+      raftBatch.draw(transPV);
+    }
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    sun.draw(transPV);
-    if (*physicsdebug)
-      globalDebug.draw(transPV);
+    {
+      auto scope = ProfileScope("sun");
+      auto gpu = gpuTimers.scope("sun");
+      sun.draw(sunBatch);
+      sunBatch.draw(transPV);
+    }
+    if (*physicsdebug) {
+      auto scope = ProfileScope("debug");
+      auto gpu = gpuTimers.scope("debug");
+      debugView.draw(globalDebug, transPV);
+    }
     inter.unbind();
 
-    screen.prepare();
-    screen.render(0.0f, 0.0f, 1.0f, 1.0f, inter.texture);
-    //		screenBlur.render(0.75f, 0.75f, 1.0f, 1.0f, inter.texture);
-    //		screenExtract.render(0.75f, 0.5f, 1.0f, 0.75f, inter.texture);
+    {
+      auto scope = ProfileScope("screen");
+      auto gpu = gpuTimers.scope("screen");
+      glViewport(0, 0, monitor.width, monitor.height);
+      screen.prepare();
+      screen.render(0.0f, 0.0f, 1.0f, 1.0f, inter.texture);
+    }
+    if (bloom) {
+      auto scope = ProfileScope("bloom");
+      auto gpu = gpuTimers.scope("bloom");
+      bloom->render(inter.texture, inter.width, inter.height, monitor.width,
+                    monitor.height);
+    }
+    resolution.end();
+    gpuTimers.collect();
+    if (capture) {
+      auto scope = ProfileScope("capture");
+      capture->frame();
+    }
+
+    callTotals.issued += glCalls.issued;
+    callTotals.elided += glCalls.elided;
 
-    window.swapBuffers();
-    glfw.pollEvents();
+    {
+      auto scope = ProfileScope("swap");
+      if (offscreen) {
+        glFinish();
+      } else {
+        window->swapBuffers();
+        glfw->pollEvents();
+      }
+    }
+    if (offscreen) {
+      frameMs.push_back(std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - frameStart)
+                            .count());
+      if (dumpFrames.count(frame)) {
+        auto path = std::ostringstream();
+        path << options.dumpDir << "/frame_" << std::setw(5)
+             << std::setfill('0') << frame << ".ppm";
+        offscreen->save(path.str());
+      }
+    }
   }
 
-  glfw.terminate();
-  return 0;
+  if (recorder)
+    lg.info("recorded ", recorder->frames, " frames to ", options.record,
+            "\n");
+  if (player) {
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - loopStart)
+                       .count();
+    lg.info("replayed ", frame, " frames in ", seconds, " s, ", frame / seconds,
+            " frames/s, physics ",
+            diverged < 0 ? "identical to" : "diverged from",
+            " the recording\n");
+  }
+  if (frame > 0 and options.render) {
+    lg.info("gl calls per frame: ", (double)callTotals.issued / frame,
+            " issued, ", (double)callTotals.elided / frame, " elided\n");
+    glFinish();
+    gpuTimers.collect();
+    gpuTimers.report();
+    resolution.report();
+  }
+  if (capture) {
+    capture->finish();
+    capture->report();
+  }
+  if (not frameMs.empty()) {
+    auto sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    auto total = 0.0;
+    for (auto ms : frameMs)
+      total += ms;
+    lg.info("offscreen: ", frameMs.size(), " frames, ms per frame: mean ",
+            total / frameMs.size(), ", median ", sorted[sorted.size() / 2],
+            ", 95th percentile ", sorted[sorted.size() * 95 / 100], "\n");
+  }
+  if (options.trace != nullptr)
+    profileWriteTrace(tracePath);
+  if (glfw != nullptr)
+    glfw->terminate();
+  return diverged < 0 ? 0 : 1;
 }
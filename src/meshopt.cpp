@@ -0,0 +1,119 @@
+#include "meshopt.hpp"
+#include <algorithm>
+#include <cmath>
+
+float acmr(const std::vector<unsigned short> &indices, int cacheSize) {
+  auto cache = std::vector<int>(cacheSize, -1);
+  auto next = 0, misses = 0;
+  for (auto index : indices) {
+    if (std::find(cache.begin(), cache.end(), index) != cache.end())
+      continue;
+    cache[next] = index;
+    next = (next + 1) % cacheSize;
+    ++misses;
+  }
+  return indices.empty() ? 0.0f : 3.0f * misses / (float)indices.size();
+}
+
+// Forsyth's constants: the simulated LRU cache and how vertex scores fall
+// off with cache position and rise as a vertex's last triangles remain.
+static const int cacheSize = 32;
+static const float cacheDecayPower = 1.5f;
+static const float lastTriangleScore = 0.75f;
+static const float valenceBoostScale = 2.0f;
+static const float valenceBoostPower = 0.5f;
+
+static float vertexScore(int cachePosition, int remaining) {
+  if (remaining == 0)
+    return -1.0f;
+  auto score = 0.0f;
+  if (cachePosition < 0)
+    score = 0.0f;
+  else if (cachePosition < 3)
+    // The triangle just emitted: using its vertices again straight away is
+    // no better than any recent vertex, so they get a fixed score.
+    score = lastTriangleScore;
+  else
+    score = std::pow(1.0f - (float)(cachePosition - 3) / (cacheSize - 3),
+                     cacheDecayPower);
+  return score +
+         valenceBoostScale * std::pow((float)remaining, -valenceBoostPower);
+}
+
+void optimizeVertexCache(std::vector<unsigned short> &indices,
+                         int vertexCount) {
+  auto triangleCount = (int)indices.size() / 3;
+  // Triangles around each vertex, as offsets into adjacency.
+  auto remaining = std::vector<int>(vertexCount, 0);
+  for (auto index : indices)
+    ++remaining[index];
+  auto first = std::vector<int>(vertexCount + 1, 0);
+  for (auto v = 0; v < vertexCount; ++v)
+    first[v + 1] = first[v] + remaining[v];
+  auto adjacency = std::vector<int>(indices.size());
+  auto filled = std::vector<int>(first.begin(), first.end() - 1);
+  for (auto t = 0; t < triangleCount; ++t)
+    for (auto k = 0; k < 3; ++k)
+      adjacency[filled[indices[3 * t + k]]++] = t;
+
+  auto cachePosition = std::vector<int>(vertexCount, -1);
+  auto score = std::vector<float>(vertexCount);
+  for (auto v = 0; v < vertexCount; ++v)
+    score[v] = vertexScore(-1, remaining[v]);
+  auto triangleScore = std::vector<float>(triangleCount);
+  auto emitted = std::vector<bool>(triangleCount, false);
+  for (auto t = 0; t < triangleCount; ++t)
+    triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] +
+                       score[indices[3 * t + 2]];
+
+  auto output = std::vector<unsigned short>();
+  output.reserve(indices.size());
+  auto cache = std::vector<int>();
+  auto best = -1;
+  for (auto done = 0; done < triangleCount; ++done) {
+    // With nothing in the cache to continue from, start over from the best
+    // triangle anywhere.
+    if (best == -1) {
+      for (auto t = 0; t < triangleCount; ++t)
+        if (not emitted[t] and (best == -1 or triangleScore[t] >
+                                                  triangleScore[best]))
+          best = t;
+    }
+    emitted[best] = true;
+    auto newCache = std::vector<int>();
+    for (auto k = 0; k < 3; ++k) {
+      auto v = indices[3 * best + k];
+      output.push_back(v);
+      newCache.push_back(v);
+      // Drop the triangle from the vertex's list of remaining ones.
+      auto begin = adjacency.begin() + first[v];
+      auto end = begin + remaining[v];
+      std::iter_swap(std::find(begin, end, best), end - 1);
+      --remaining[v];
+    }
+    for (auto v : cache)
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+        newCache.push_back(v);
+    // Vertices pushed out of the cache lose their position and with it most
+    // of their score; everything still inside is rescored for its new place.
+    for (auto i = 0; i < (int)newCache.size(); ++i) {
+      auto v = newCache[i];
+      cachePosition[v] = i < cacheSize ? i : -1;
+      score[v] = vertexScore(cachePosition[v], remaining[v]);
+    }
+    best = -1;
+    for (auto v : newCache) {
+      for (auto i = first[v]; i < first[v] + remaining[v]; ++i) {
+        auto t = adjacency[i];
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] +
+                           score[indices[3 * t + 2]];
+        if (best == -1 or triangleScore[t] > triangleScore[best])
+          best = t;
+      }
+    }
+    if ((int)newCache.size() > cacheSize)
+      newCache.resize(cacheSize);
+    cache.swap(newCache);
+  }
+  indices.swap(output);
+}
@@ -0,0 +1,20 @@
+#ifndef SURFACES_MESHOPT_HPP
+#define SURFACES_MESHOPT_HPP
+
+#include <vector>
+
+// Average cache miss ratio: vertex shader runs per triangle for a triangle
+// list drawn through a FIFO post-transform cache of cacheSize entries. Three
+// means no reuse at all; a large regular grid approaches 0.5.
+float acmr(const std::vector<unsigned short> &indices, int cacheSize);
+
+// Reorders the triangles of a triangle list for post-transform cache reuse,
+// after Forsyth, "Linear-Speed Vertex Cache Optimisation". Each step emits
+// the best scoring triangle among those touching the simulated cache, where
+// vertices score higher the more recently they were used and the fewer
+// triangles they have left, so the order sweeps the mesh in narrow bands
+// without stranding lone triangles behind it.
+void optimizeVertexCache(std::vector<unsigned short> &indices,
+                         int vertexCount);
+
+#endif // SURFACES_MESHOPT_HPP
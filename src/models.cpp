@@ -9,10 +9,9 @@ CubeVertices::CubeVertices() : vbo(), vao() {
 }
 void CubeVertices::draw() {
   vao.bind();
-  glDrawArrays(GL_TRIANGLES, 0, sizeof(rawData) / sizeof(rawData[0]));
-  vao.unbind();
+  glDrawArrays(GL_TRIANGLES, 0, vertexCount);
 }
-const float CubeVertices::rawData[6 * 6 * 3] = {
+const float CubeVertices::rawData[vertexCount * 3] = {
     -0.5f, -0.5f, -0.5f, 0.5f,  -0.5f, -0.5f, 0.5f,  0.5f,  -0.5f,
     0.5f,  0.5f,  -0.5f, -0.5f, 0.5f,  -0.5f, -0.5f, -0.5f, -0.5f,
 
@@ -8,7 +8,8 @@ struct CubeVertices {
   VAO vao;
   CubeVertices();
   void draw();
-  static const float rawData[6 * 6 * 3];
+  static const int vertexCount = 6 * 6;
+  static const float rawData[vertexCount * 3];
 };
 
 struct QuadVertices {
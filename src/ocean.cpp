@@ -0,0 +1,234 @@
+#include "ocean.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <glm/glm.hpp>
+#include <random>
+
+Ocean *ocean = nullptr;
+
+static const float pi = 3.14159265358979f;
+static const float g = 9.80665f;
+// Rows and columns handed to each job.
+static const int rowGrain = 8;
+static const int columnGrain = 16;
+// Phillips amplitude, chosen to give about the significant wave height a
+// fully developed sea has for the same wind.
+static const float phillipsAmplitude = 3e-3f;
+// Phillips waves running against the wind keep this much of their energy.
+static const float phillipsAgainstWind = 0.07f;
+
+// Variance density of the surface height per unit of wavenumber area.
+static float phillips(const OceanSettings &settings, glm::vec2 k) {
+  auto k2 = glm::dot(k, k);
+  auto largest = settings.windSpeed * settings.windSpeed / g;
+  auto smallest = largest / 1000;
+  auto alignment = glm::dot(k, settings.windDirection);
+  auto directional = alignment * alignment / k2;
+  if (alignment < 0.0f)
+    directional *= phillipsAgainstWind;
+  return phillipsAmplitude * std::exp(-1.0f / (k2 * largest * largest)) /
+         (k2 * k2) * directional * std::exp(-k2 * smallest * smallest);
+}
+
+// JONSWAP frequency spectrum moved to wavenumbers through the dispersion
+// relation, spread over directions by 2 / pi * cos^2 around the wind.
+static float jonswap(const OceanSettings &settings, glm::vec2 k) {
+  auto u = settings.windSpeed, fetch = settings.fetch;
+  auto alpha = 0.076f * std::pow(u * u / (fetch * g), 0.22f);
+  auto peak = 22.0f * std::cbrt(g * g / (u * fetch));
+  auto length = glm::length(k);
+  auto w = std::sqrt(g * length);
+  auto sigma = w <= peak ? 0.07f : 0.09f;
+  auto r = std::exp(-(w - peak) * (w - peak) /
+                    (2 * sigma * sigma * peak * peak));
+  auto s = alpha * g * g / std::pow(w, 5.0f) *
+           std::exp(-1.25f * std::pow(peak / w, 4.0f)) * std::pow(3.3f, r);
+  auto cosine = glm::dot(k, settings.windDirection) / length;
+  auto spreading = cosine > 0.0f ? 2 / pi * cosine * cosine : 0.0f;
+  return s * g / (2 * w) / length * spreading;
+}
+
+// In place radix-2 inverse DFT of count complex elements, element e at
+// offset e * stride, each a run of lanes independent transforms laid out
+// contiguously. Rows are one lane with stride 1; columns are a block of lanes
+// with stride size, which keeps the innermost loop on consecutive floats.
+static void inverseFFT(float *re, float *im, int count, int stride, int lanes,
+                       const std::vector<float> &twiddleRe,
+                       const std::vector<float> &twiddleIm,
+                       const std::vector<int> &bitReverse) {
+  for (auto e = 0; e < count; ++e) {
+    auto r = bitReverse[e];
+    if (e < r) {
+      for (auto l = 0; l < lanes; ++l) {
+        std::swap(re[e * stride + l], re[r * stride + l]);
+        std::swap(im[e * stride + l], im[r * stride + l]);
+      }
+    }
+  }
+  for (auto span = 2; span <= count; span *= 2) {
+    auto half = span / 2, step = count / span;
+    for (auto start = 0; start < count; start += span) {
+      for (auto k = 0; k < half; ++k) {
+        auto wr = twiddleRe[k * step], wi = twiddleIm[k * step];
+        auto ar = re + (start + k) * stride, ai = im + (start + k) * stride;
+        auto br = ar + half * stride, bi = ai + half * stride;
+        for (auto l = 0; l < lanes; ++l) {
+          auto tr = wr * br[l] - wi * bi[l];
+          auto ti = wr * bi[l] + wi * br[l];
+          br[l] = ar[l] - tr;
+          bi[l] = ai[l] - ti;
+          ar[l] += tr;
+          ai[l] += ti;
+        }
+      }
+    }
+  }
+}
+
+Ocean::Ocean(const OceanSettings &settings)
+    : n(settings.size), tileLength(settings.length),
+      choppiness(settings.choppiness) {
+  if (n < 2 or (n & (n - 1)) != 0 or not(tileLength > 0.0f)) {
+    lg.error("ocean needs a power of two size and a positive length, got ",
+             n, " and ", tileLength, "\n");
+    std::exit(1);
+  }
+  auto cells = (size_t)n * n;
+  height.resize(cells);
+  displacementX.resize(cells);
+  displacementZ.resize(cells);
+  h0Re.resize(cells);
+  h0Im.resize(cells);
+  omega.resize(cells);
+  aRe.resize(cells);
+  aIm.resize(cells);
+  bRe.resize(cells);
+  bIm.resize(cells);
+  for (auto k = 0; k < n / 2; ++k) {
+    twiddleRe.push_back(std::cos(2 * pi * k / n));
+    twiddleIm.push_back(std::sin(2 * pi * k / n));
+  }
+  auto bits = 0;
+  while ((1 << bits) < n)
+    ++bits;
+  for (auto e = 0; e < n; ++e) {
+    auto r = 0;
+    for (auto b = 0; b < bits; ++b)
+      r |= ((e >> b) & 1) << (bits - 1 - b);
+    bitReverse.push_back(r);
+  }
+  // Box-Muller on mt19937, whose output, unlike std::normal_distribution's,
+  // is the same on every standard library.
+  auto engine = std::mt19937(settings.seed);
+  auto uniform = [&]() { return ((float)engine() + 0.5f) / 4294967296.0f; };
+  auto windSettings = settings;
+  windSettings.windDirection = glm::normalize(settings.windDirection);
+  auto dk = 2 * pi / tileLength;
+  for (auto j = 0; j < n; ++j) {
+    for (auto i = 0; i < n; ++i) {
+      auto radius = std::sqrt(-2 * std::log(uniform()));
+      auto angle = 2 * pi * uniform();
+      auto fx = i < n / 2 ? i : i - n, fz = j < n / 2 ? j : j - n;
+      auto k = dk * glm::vec2(fx, fz);
+      auto index = j * n + i;
+      // The mean and the Nyquist frequencies have no partner of opposite
+      // wavenumber, so they would leave imaginary parts in the result.
+      if ((fx == 0 and fz == 0) or i == n / 2 or j == n / 2) {
+        h0Re[index] = h0Im[index] = omega[index] = 0.0f;
+        continue;
+      }
+      auto spectrum = settings.jonswap ? jonswap(windSettings, k)
+                                       : phillips(windSettings, k);
+      auto amplitude = std::sqrt(spectrum * dk * dk / 2);
+      h0Re[index] = radius * std::cos(angle) * amplitude / std::sqrt(2.0f);
+      h0Im[index] = radius * std::sin(angle) * amplitude / std::sqrt(2.0f);
+      omega[index] = std::sqrt(g * glm::length(k));
+    }
+  }
+  update(0.0f);
+}
+
+// h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t), and the horizontal
+// displacement spectrum i k / |k| h(k, t), negated from Tessendorf's D so a
+// positive choppiness pulls points towards the crests.
+void Ocean::spectrumRows(int begin, int end, float time) {
+  for (auto j = begin; j < end; ++j) {
+    for (auto i = 0; i < n; ++i) {
+      auto index = j * n + i;
+      auto opposite = ((n - j) & (n - 1)) * n + ((n - i) & (n - 1));
+      auto c = std::cos(omega[index] * time), s = std::sin(omega[index] * time);
+      auto hRe = (h0Re[index] + h0Re[opposite]) * c -
+                 (h0Im[index] + h0Im[opposite]) * s;
+      auto hIm = (h0Re[index] - h0Re[opposite]) * s +
+                 (h0Im[index] - h0Im[opposite]) * c;
+      auto fx = (float)(i < n / 2 ? i : i - n);
+      auto fz = (float)(j < n / 2 ? j : j - n);
+      auto norm = std::sqrt(fx * fx + fz * fz);
+      auto kx = norm > 0.0f ? choppiness * fx / norm : 0.0f;
+      auto kz = norm > 0.0f ? choppiness * fz / norm : 0.0f;
+      // a = h + i dx with dx = i kx h, so a = h - kx h.
+      aRe[index] = hRe - kx * hRe;
+      aIm[index] = hIm - kx * hIm;
+      bRe[index] = -kz * hIm;
+      bIm[index] = kz * hRe;
+    }
+  }
+}
+
+void Ocean::update(float time) {
+  parallelFor(n, rowGrain,
+              [&](int begin, int end) { spectrumRows(begin, end, time); });
+  parallelFor(n, rowGrain, [&](int begin, int end) {
+    for (auto j = begin; j < end; ++j) {
+      inverseFFT(aRe.data() + j * n, aIm.data() + j * n, n, 1, 1, twiddleRe,
+                 twiddleIm, bitReverse);
+      inverseFFT(bRe.data() + j * n, bIm.data() + j * n, n, 1, 1, twiddleRe,
+                 twiddleIm, bitReverse);
+    }
+  });
+  parallelFor(n, columnGrain, [&](int begin, int end) {
+    inverseFFT(aRe.data() + begin, aIm.data() + begin, n, n, end - begin,
+               twiddleRe, twiddleIm, bitReverse);
+    inverseFFT(bRe.data() + begin, bIm.data() + begin, n, n, end - begin,
+               twiddleRe, twiddleIm, bitReverse);
+  });
+  parallelFor(n, rowGrain, [&](int begin, int end) {
+    for (auto index = begin * n; index < end * n; ++index) {
+      height[index] = aRe[index];
+      displacementX[index] = aIm[index];
+      displacementZ[index] = bRe[index];
+    }
+  });
+}
+
+float Ocean::sample(const std::vector<float> &grid, float x, float z) const {
+  auto gx = x / tileLength * n, gz = z / tileLength * n;
+  auto fx = std::floor(gx), fz = std::floor(gz);
+  auto tx = gx - fx, tz = gz - fz;
+  auto i0 = (int)(long long)fx & (n - 1), j0 = (int)(long long)fz & (n - 1);
+  auto i1 = (i0 + 1) & (n - 1), j1 = (j0 + 1) & (n - 1);
+  auto near = grid[j0 * n + i0] + tx * (grid[j0 * n + i1] - grid[j0 * n + i0]);
+  auto far = grid[j1 * n + i0] + tx * (grid[j1 * n + i1] - grid[j1 * n + i0]);
+  return near + tz * (far - near);
+}
+
+float Ocean::heightAt(float x, float z) const {
+  if (choppiness != 0.0f) {
+    auto dx = sample(displacementX, x, z), dz = sample(displacementZ, x, z);
+    x -= dx;
+    z -= dz;
+  }
+  return sample(height, x, z);
+}
+
+void Ocean::heights(const float *x, const float *z, float *heights,
+                    int count) const {
+  for (auto i = 0; i < count; ++i)
+    heights[i] = heightAt(x[i], z[i]);
+}
+
+int Ocean::size() const { return n; }
+
+float Ocean::length() const { return tileLength; }
@@ -0,0 +1,59 @@
+#ifndef SURFACES_OCEAN_HPP
+#define SURFACES_OCEAN_HPP
+
+#include <glm/vec2.hpp>
+#include <vector>
+
+struct OceanSettings {
+  int size = 128;          // grid points along each side, a power of two
+  float length = 512.0f;   // metres covered by one tile
+  float windSpeed = 12.0f; // metres per second, ten metres above the water
+  glm::vec2 windDirection = {1.0f, 0.0f}; // in the x-z plane
+  bool jonswap = false;     // JONSWAP spectrum instead of Phillips
+  float fetch = 100000.0f;  // metres of open water upwind, JONSWAP only
+  float choppiness = 1.0f;  // horizontal displacement scale, 0 turns it off
+  unsigned seed = 1;
+};
+
+// Spectral ocean after Tessendorf, "Simulating Ocean Water". Random wave
+// amplitudes are drawn once from a Phillips or JONSWAP spectrum; update()
+// advances their phases with the deep water dispersion relation and runs
+// inverse 2D FFTs to get a tileable grid of heights and, with choppiness, the
+// horizontal displacements that sharpen the crests. The cost of a step depends
+// only on size, and queries are bilinear lookups into the grids.
+//
+// The FFT keeps real and imaginary parts in separate arrays and does the
+// column pass with whole rows as butterfly operands, so its inner loops run
+// over contiguous floats. Rows, columns and spectrum rows are split across
+// ::jobs, and nothing is allocated after construction.
+struct Ocean {
+  explicit Ocean(const OceanSettings &settings);
+  void update(float time);
+  // Height of the displaced surface above the point (x, z), undoing the
+  // horizontal displacement with one fixed point iteration.
+  float heightAt(float x, float z) const;
+  void heights(const float *x, const float *z, float *heights,
+               int count) const;
+  int size() const;
+  float length() const;
+  // Row-major grids, index z * size() + x, spaced length() / size() apart.
+  std::vector<float> height, displacementX, displacementZ;
+
+private:
+  float sample(const std::vector<float> &grid, float x, float z) const;
+  void spectrumRows(int begin, int end, float time);
+  int n;
+  float tileLength;
+  float choppiness;
+  std::vector<float> h0Re, h0Im, omega;
+  std::vector<float> twiddleRe, twiddleIm;
+  std::vector<int> bitReverse;
+  // Spectra and then, in place, their transforms: height + i displacementX
+  // in a, displacementZ in b.
+  std::vector<float> aRe, aIm, bRe, bIm;
+};
+
+// Set to make the physics sample this ocean instead of the analytic wave.
+extern Ocean *ocean;
+
+#endif // SURFACES_OCEAN_HPP
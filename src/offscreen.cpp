@@ -0,0 +1,97 @@
+#include "offscreen.hpp"
+#include "lg.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay openDisplay() {
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  auto display = getPlatformDisplay != nullptr
+                     ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                          EGL_DEFAULT_DISPLAY, nullptr)
+                     : EGL_NO_DISPLAY;
+  if (display == EGL_NO_DISPLAY or
+      not eglInitialize(display, nullptr, nullptr)) {
+    lg.error("failed to open a surfaceless EGL display\n");
+    std::exit(1);
+  }
+  return display;
+}
+
+// Creates the context, makes it current with no surface and loads GL, all
+// before any GL object of Offscreen is made.
+static EGLContext createContext(EGLDisplay display) {
+  const EGLint configAttributes[] = {EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE,
+                                     EGL_OPENGL_BIT, EGL_NONE};
+  const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_MINOR_VERSION,
+                                      3,
+                                      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                      EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+  auto config = EGLConfig();
+  auto count = 0;
+  if (not eglBindAPI(EGL_OPENGL_API) or
+      not eglChooseConfig(display, configAttributes, &config, 1, &count) or
+      count < 1) {
+    lg.error("no EGL config for desktop GL\n");
+    std::exit(1);
+  }
+  auto context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  if (context == EGL_NO_CONTEXT or
+      not eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+    lg.error("failed to create a surfaceless GL 3.3 context\n");
+    std::exit(1);
+  }
+  loadGLAD((GLADloadproc)eglGetProcAddress);
+  return context;
+}
+
+Offscreen::Offscreen(int width, int height)
+    : display(openDisplay()), context(createContext(display)), width(width),
+      height(height), color(), depth(), fbo() {
+  color.bind(GL_RENDERBUFFER);
+  color.storage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  depth.bind(GL_RENDERBUFFER);
+  depth.storage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+  depth.unbind(GL_RENDERBUFFER);
+  fbo.bind(GL_FRAMEBUFFER);
+  fbo.renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                   color);
+  fbo.renderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                   depth);
+  fbo.xassertComplete(GL_FRAMEBUFFER);
+  xdefaultFramebuffer(fbo);
+  glViewport(0, 0, width, height);
+  glEnable(GL_DEPTH_TEST);
+  lg.info("offscreen: ", glGetString(GL_RENDERER), ", ",
+          glGetString(GL_VERSION), "\n");
+}
+
+Offscreen::~Offscreen() {
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+}
+
+void Offscreen::save(const std::string &path) {
+  auto pixels = std::vector<unsigned char>(3 * width * height);
+  fbo.bind(GL_READ_FRAMEBUFFER);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+  auto file = std::ofstream(path, std::ios::binary);
+  file << "P6\n" << width << " " << height << "\n255\n";
+  // GL rows run bottom up, PPM rows top down.
+  for (auto row = height - 1; row >= 0; --row)
+    file.write((const char *)&pixels[3 * width * row], 3 * width);
+  if (not file) {
+    lg.error("failed to write ", path, "\n");
+    std::exit(1);
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef SURFACES_OFFSCREEN_HPP
+#define SURFACES_OFFSCREEN_HPP
+
+#include "xgl.hpp"
+#include <string>
+
+// A GL 3.3 core context with no window, on a surfaceless EGL display. It runs
+// on Mesa's llvmpipe on machines that have neither a display nor a GPU. A
+// width x height colour and depth framebuffer stands in for the window's.
+struct Offscreen {
+  Offscreen(int width, int height);
+  ~Offscreen();
+  Offscreen(const Offscreen &) = delete;
+  Offscreen &operator=(const Offscreen &) = delete;
+  // Writes the stand-in framebuffer as a binary PPM.
+  void save(const std::string &path);
+  void *display; // EGLDisplay
+  void *context; // EGLContext
+  int width, height;
+  RBO color, depth;
+  FBO fbo;
+};
+
+#endif // SURFACES_OFFSCREEN_HPP
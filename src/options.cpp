@@ -0,0 +1,102 @@
+#include "options.hpp"
+#include "debug.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Comma separated category names, as in "gravity,drag".
+static unsigned debugCategoryMask(const std::string &names) {
+  auto mask = 0u;
+  auto begin = (size_t)0;
+  while (begin <= names.size()) {
+    auto end = std::min(names.find(',', begin), names.size());
+    mask |= 1u << (int)debugCategoryFromName(names.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return mask;
+}
+
+Options parseOptions(int argc, char **argv) {
+  auto options = Options{jobThreadsFromEnvironment(), 240.0f, 8, false, false,
+                         ".cache/programs", 0, ~0u, nullptr, nullptr, nullptr,
+                         true, 0, "", "frames", nullptr, 5, 0.0f, 16.0f};
+  for (auto i = 1; i < argc; ++i) {
+    auto flag = argv[i];
+    if (i + 1 >= argc) {
+      lg.error("missing value for ", flag, "\n");
+      std::exit(1);
+    }
+    auto value = argv[++i];
+    if (not strcmp(flag, "--threads"))
+      options.threads = std::atoi(value);
+    else if (not strcmp(flag, "--physics-rate"))
+      options.physicsRate = (float)std::atof(value);
+    else if (not strcmp(flag, "--max-substeps"))
+      options.maxSubsteps = std::atoi(value);
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "sines"))
+      options.ocean = false;
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "phillips"))
+      options.ocean = true, options.jonswap = false;
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "jonswap"))
+      options.ocean = true, options.jonswap = true;
+    else if (not strcmp(flag, "--debug-categories"))
+      options.debugCategories = debugCategoryMask(value);
+    else if (not strcmp(flag, "--trace"))
+      options.trace = value;
+    else if (not strcmp(flag, "--record"))
+      options.record = value;
+    else if (not strcmp(flag, "--replay"))
+      options.replay = value;
+    else if (not strcmp(flag, "--render") and not strcmp(value, "on"))
+      options.render = true;
+    else if (not strcmp(flag, "--render") and not strcmp(value, "off"))
+      options.render = false;
+    else if (not strcmp(flag, "--offscreen"))
+      options.offscreen = std::atoi(value);
+    else if (not strcmp(flag, "--dump-frames"))
+      options.dumpFrames = value;
+    else if (not strcmp(flag, "--dump-dir"))
+      options.dumpDir = value;
+    else if (not strcmp(flag, "--capture"))
+      options.capture = value;
+    else if (not strcmp(flag, "--bloom-levels"))
+      options.bloomLevels = std::atoi(value);
+    else if (not strcmp(flag, "--resolution-scale") and
+             not strcmp(value, "auto"))
+      options.resolutionScale = 0.0f;
+    else if (not strcmp(flag, "--resolution-scale"))
+      options.resolutionScale = (float)std::atof(value);
+    else if (not strcmp(flag, "--gpu-budget"))
+      options.gpuBudget = (float)std::atof(value);
+    else if (not strcmp(flag, "--rafts"))
+      options.rafts = std::atoi(value);
+    else if (not strcmp(flag, "--program-cache") and not strcmp(value, "off"))
+      options.programCache = "";
+    else if (not strcmp(flag, "--program-cache"))
+      options.programCache = value;
+    else {
+      lg.error("unknown flag ", flag, "\n");
+      std::exit(1);
+    }
+  }
+  if (not options.render and options.replay == nullptr) {
+    lg.error("--render off needs --replay\n");
+    std::exit(1);
+  }
+  if (*options.dumpFrames and options.offscreen <= 0) {
+    lg.error("--dump-frames needs --offscreen\n");
+    std::exit(1);
+  }
+  if (not(options.resolutionScale >= 0.0f and
+          options.resolutionScale <= 1.0f)) {
+    lg.error("--resolution-scale takes auto or a scale in (0, 1]\n");
+    std::exit(1);
+  }
+  if (not(options.gpuBudget > 0.0f)) {
+    lg.error("--gpu-budget needs a positive number of milliseconds\n");
+    std::exit(1);
+  }
+  return options;
+}
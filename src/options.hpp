@@ -0,0 +1,29 @@
+#ifndef SURFACES_OPTIONS_HPP
+#define SURFACES_OPTIONS_HPP
+
+// Command line of the main binary.
+struct Options {
+  int threads;
+  float physicsRate;
+  int maxSubsteps;
+  bool ocean;   // spectral ocean instead of the analytic wave
+  bool jonswap; // JONSWAP spectrum for the ocean instead of Phillips
+  const char *programCache; // program binary directory, empty for none
+  int rafts;                // extra rafts, stepped together in a RaftWorld
+  unsigned debugCategories; // debug categories F5 shows, one bit each
+  const char *trace;  // profile trace path for F6 and exit; null: F6 only
+  const char *record; // input log to write, or null
+  const char *replay; // input log to play instead of live input, or null
+  bool render;        // draw frames; off needs a replay
+  int offscreen;      // frames to render without a window, 0 for a window
+  const char *dumpFrames; // offscreen frames to save, as in "0,30,59"
+  const char *dumpDir;    // where saved frames go
+  const char *capture;    // .rgb stream or directory to record frames to
+  int bloomLevels;        // bloom blur levels, 0 for no bloom
+  float resolutionScale;  // scene resolution over the window's, 0 for auto
+  float gpuBudget;        // GPU ms per frame the auto resolution aims for
+};
+
+Options parseOptions(int argc, char **argv);
+
+#endif // SURFACES_OPTIONS_HPP
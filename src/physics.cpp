@@ -1,8 +1,11 @@
 #include "physics.hpp"
 #include "debug.hpp"
+#include "jobs.hpp"
 #include "lg.hpp"
 #include "math.hpp"
+#include "ocean.hpp"
 #include "wave.hpp"
+#include <algorithm>
 #include <glm/glm.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/vector_angle.hpp>
@@ -14,84 +17,151 @@ std::ostream &operator<<(std::ostream &out, const ForceApplication2 &app) {
   return out << app.force << " applied to " << app.point;
 }
 
+RaftForces::RaftForces() : acceleration(0.0f, 0.0f), torque(0.0f) {}
+
+RaftFrame::RaftFrame(const glm::vec3 &position, const glm::vec3 &scale,
+                     float rotation, float mass, int probes)
+    : direction(cosf(rotation), sinf(rotation)),
+      vergeLeft(position -
+                scale.z / 2 * glm::vec3(0.0f, direction.y, direction.x)),
+      vergeRight(position +
+                 scale.z / 2 * glm::vec3(0.0f, direction.y, direction.x)),
+      scalePart(scale * glm::vec3(1.0f, 1.0f, 1.0f / probes)),
+      massPart(mass / probes) {}
+
 RaftPhysics::RaftPhysics(glm::vec3 position, glm::vec3 scale, float mass,
                          int probes)
     : position(position), velocity(), scale(scale), rotation(0.0f),
       angularVelocity(0.0f), mass(mass), probes(probes) {}
 
 void RaftPhysics::update(float deltaTime, float time) {
-  auto acceleration = glm::vec2(0.0f, 0.0f);
-  auto torque = 0.0f;
   auto forces = computeForces(time);
-  for (auto force : forces) {
-    acceleration += force.force / mass;
-    torque += torqueFromForce(force);
-  }
-  auto momentOfInertia =
-      (1.0f / 12) * mass * (powf(scale.z, 2) + powf(scale.y, 2));
-  auto angularAcceleration = torque / momentOfInertia;
-  velocity += deltaTime * acceleration;
-  position += deltaTime * glm::vec3(0.0f, velocity.y, velocity.x);
-  angularVelocity += deltaTime * angularAcceleration;
-  rotation += deltaTime * angularVelocity;
+  raftIntegrate(position, velocity, rotation, angularVelocity, scale, mass,
+                forces, deltaTime);
 }
 
-std::vector<ForceApplication2> RaftPhysics::computeForces(float time) {
-  auto forces = std::vector<ForceApplication2>();
-  auto n = probes;
-  auto scalePart = scale * glm::vec3(1.0f, 1.0f, 1.0f / n);
-  auto vergeLeft =
-      position - scale.z / 2 * glm::vec3(0.0f, sinf(rotation), cosf(rotation));
-  auto vergeRight =
-      position + scale.z / 2 * glm::vec3(0.0f, sinf(rotation), cosf(rotation));
-  for (auto i = 0; i < n; ++i) {
-    auto positionPart = mix(vergeLeft, vergeRight, (2.0f * i + 1) / (2 * n));
-    auto armLength = glm::length(position - positionPart);
-    auto armSign = i < n / 2 ? -1 : +1;
-    auto angTraj = glm::vec2(-sinf(rotation), cosf(rotation));
-    auto linearVelocity = angularVelocity * armLength * armSign * angTraj;
-    auto part = RaftPart(positionPart, velocity + linearVelocity, scalePart,
-                         rotation, mass / n);
-    forces.push_back(part.weight());
-    forces.push_back(part.buoyancy(time));
-    forces.push_back(part.drag(time));
+// Rafts with at least this many probes split them across ::jobs in batches,
+// producing at most maxProbeChunks partial sums.
+static const int parallelProbeThreshold = 256;
+static const int maxProbeChunks = 64;
+
+RaftForces RaftPhysics::computeForces(float time) {
+  auto frame = RaftFrame(position, scale, rotation, mass, probes);
+  auto accumulateProbes = [&](RaftForces &forces, int begin, int end) {
+    for (auto i = begin; i < end; ++i) {
+      auto part =
+          raftProbe(frame, position, velocity, angularVelocity, probes, i);
+      auto waveHeight = ocean != nullptr
+                            ? ocean->heightAt(part.position.x, part.position.z)
+                            : waveHeightAtPoint(part.position, time);
+      raftAccumulate(forces, position, frame.direction, mass, part.weight());
+      raftAccumulate(forces, position, frame.direction, mass,
+                     part.buoyancy(waveHeight));
+      raftAccumulate(forces, position, frame.direction, mass,
+                     part.drag(waveHeight));
+    }
+  };
+  if (jobs == nullptr or probes < parallelProbeThreshold) {
+    auto forces = RaftForces();
+    accumulateProbes(forces, 0, probes);
+    return forces;
+  }
+  // Partial sums are combined in chunk order, so with a deterministic job
+  // system the result does not depend on the thread count. Debug output is
+  // not thread safe, so while debugging the same chunks run here in order,
+  // which keeps the arithmetic and the trajectory unchanged.
+  RaftForces partials[maxProbeChunks];
+  auto grain = std::max(32, (probes + maxProbeChunks - 1) / maxProbeChunks);
+  auto size = jobs->chunkSize(probes, grain);
+  if (debugging()) {
+    for (auto begin = 0; begin < probes; begin += size)
+      accumulateProbes(partials[begin / size], begin,
+                       std::min(probes, begin + size));
+  } else {
+    jobs->parallelFor(probes, grain, [&](int begin, int end) {
+      accumulateProbes(partials[begin / size], begin, end);
+    });
+  }
+  auto forces = RaftForces();
+  for (auto chunk = 0; chunk * size < probes; ++chunk) {
+    forces.acceleration += partials[chunk].acceleration;
+    forces.torque += partials[chunk].torque;
   }
   return forces;
 }
 
 float RaftPhysics::torqueFromForce(ForceApplication2 applied) {
+  return raftTorque(position, {cosf(rotation), sinf(rotation)}, applied);
+}
+
+RaftPart raftProbe(const RaftFrame &frame, const glm::vec3 &position,
+                   const glm::vec2 &velocity, float angularVelocity,
+                   int probes, int i) {
+  auto n = probes;
+  auto positionPart =
+      mix(frame.vergeLeft, frame.vergeRight, (2.0f * i + 1) / (2 * n));
+  auto armLength = glm::length(position - positionPart);
+  auto armSign = i < n / 2 ? -1 : +1;
+  auto angTraj = glm::vec2(-frame.direction.y, frame.direction.x);
+  auto linearVelocity = angularVelocity * armLength * armSign * angTraj;
+  return RaftPart(positionPart, velocity + linearVelocity, frame.scalePart,
+                  frame.direction, frame.massPart);
+}
+
+void raftAccumulate(RaftForces &forces, const glm::vec3 &position,
+                    glm::vec2 direction, float mass,
+                    ForceApplication2 applied) {
+  forces.acceleration += applied.force / mass;
+  forces.torque += raftTorque(position, direction, applied);
+}
+
+float raftTorque(const glm::vec3 &position, glm::vec2 direction,
+                 ForceApplication2 applied) {
   auto application = applied.point;
   auto axis = map2D(position);
   auto r = glm::length(application - axis);
   auto force = applied.force;
-  auto arm = -glm::sign(
-      glm::dot({cosf(rotation), sinf(rotation)}, application - axis));
-  auto torque = arm * (force.x * sinf(rotation) - force.y * cosf(rotation)) * r;
+  auto arm = -glm::sign(glm::dot(direction, application - axis));
+  auto torque = arm * (force.x * direction.y - force.y * direction.x) * r;
   return torque;
 }
 
+void raftIntegrate(glm::vec3 &position, glm::vec2 &velocity, float &rotation,
+                   float &angularVelocity, const glm::vec3 &scale, float mass,
+                   RaftForces forces, float deltaTime) {
+  auto momentOfInertia =
+      (1.0f / 12) * mass * (powf(scale.z, 2) + powf(scale.y, 2));
+  auto angularAcceleration = forces.torque / momentOfInertia;
+  velocity += deltaTime * forces.acceleration;
+  position += deltaTime * glm::vec3(0.0f, velocity.y, velocity.x);
+  angularVelocity += deltaTime * angularAcceleration;
+  rotation += deltaTime * angularVelocity;
+}
+
 RaftPart::RaftPart(const glm::vec3 &position, const glm::vec2 &velocity,
-                   const glm::vec3 &scale, float rotation, float mass)
-    : position(position), velocity(velocity), scale(scale), rotation(rotation),
-      mass(mass) {}
+                   const glm::vec3 &scale, glm::vec2 direction, float mass)
+    : position(position), velocity(velocity), scale(scale),
+      direction(direction), mass(mass) {}
 
 ForceApplication2 RaftPart::weight() {
   auto weight = mass * map2D(gravity);
-  debug->point(position + map3D(weight) / (5 * mass), "gravity");
+  if (debugging(DebugCategory::gravity))
+    debug->point(position + map3D(weight) / (5 * mass), DebugCategory::gravity);
   return {position, weight};
 }
 
-ForceApplication2 RaftPart::buoyancy(float time) {
-  auto waveHeight = waveHeightAtPoint(position, time);
+ForceApplication2 RaftPart::buoyancy(float waveHeight) {
   auto submergedHeight = waveHeight > position.y ? scale.y : 0.0f;
   auto area = scale.x * scale.z;
   auto displacedWaterVolume = area * submergedHeight;
   auto buoyancy = -water.density * displacedWaterVolume * map2D(gravity);
-  debug->point(position + map3D(buoyancy) / (5 * mass), "buoyancy");
+  if (debugging(DebugCategory::buoyancy))
+    debug->point(position + map3D(buoyancy) / (5 * mass),
+                 DebugCategory::buoyancy);
   return {position, buoyancy};
 }
 
-ForceApplication2 RaftPart::drag(float time) {
+float dragCoefficient(float angle) {
   static const std::pair<float, float> inclinedCoefficients[] = {
       // TODO enter more precise values
       // http://www.iawe.org/Proceedings/BBAA7/X.Ortiz.pdf
@@ -99,14 +169,6 @@ ForceApplication2 RaftPart::drag(float time) {
       {45.0f, 0.7f}, {50.0f, 0.8f}, {55.0f, 0.85f}, {60.0f, 0.9f},
       {70.0f, 1.0f}, {80.0f, 1.1f}, {90.0f, 1.1f},
   };
-  auto touchPosition =
-      map2D(position) +
-      glm::vec2(cosf(rotation), sinf(rotation)) * scale.y / 2.0f;
-  auto underwater = touchPosition.y > waveHeightAtPoint(position, time);
-  auto fluidDensity = (underwater ? air : water).density;
-  // TODO check correctness of angle calculation
-  auto angle = acuteAngle(velocity, glm::vec2(cosf(rotation), sinf(rotation)));
-  auto relativeArea = scale.x * scale.z * sinf(angle);
   // TODO check correctness of datum selection
   auto datum =
       std::lower_bound(begin(inclinedCoefficients), end(inclinedCoefficients),
@@ -114,10 +176,21 @@ ForceApplication2 RaftPart::drag(float time) {
   if (datum == end(inclinedCoefficients))
     --datum;
   // TODO interpolate between data
-  auto dragCoefficient = datum->second;
+  return datum->second;
+}
+
+ForceApplication2 RaftPart::drag(float waveHeight) {
+  auto touchPosition = map2D(position) + direction * scale.y / 2.0f;
+  auto underwater = touchPosition.y > waveHeight;
+  auto fluidDensity = (underwater ? air : water).density;
+  // TODO check correctness of angle calculation
+  auto angle = acuteAngle(velocity, direction);
+  auto relativeArea = scale.x * scale.z * sinf(angle);
   auto drag = -enorm(velocity) * 0.5f * fluidDensity *
-              powf(glm::length(velocity), 2) * dragCoefficient * relativeArea;
-  debug->point(position + map3D(drag) / (5 * mass), "drag");
+              powf(glm::length(velocity), 2) * dragCoefficient(angle) *
+              relativeArea;
+  if (debugging(DebugCategory::drag))
+    debug->point(position + map3D(drag) / (5 * mass), DebugCategory::drag);
   return {touchPosition, drag};
 }
 
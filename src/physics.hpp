@@ -4,7 +4,6 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <iostream>
-#include <vector>
 
 struct Material {
   float density; // kg/m^3
@@ -18,6 +17,25 @@ struct ForceApplication2 {
                                   const ForceApplication2 &app);
 };
 
+// Linear acceleration and torque summed over every force acting on a raft.
+struct RaftForces {
+  glm::vec2 acceleration;
+  float torque;
+  RaftForces();
+};
+
+// Quantities every probe of a raft shares during one step, so the sine and
+// cosine of its rotation are evaluated once per raft instead of in each helper.
+struct RaftFrame {
+  glm::vec2 direction; // cos and sin of the rotation
+  glm::vec3 vergeLeft;
+  glm::vec3 vergeRight;
+  glm::vec3 scalePart;
+  float massPart;
+  RaftFrame(const glm::vec3 &position, const glm::vec3 &scale, float rotation,
+            float mass, int probes);
+};
+
 struct RaftPhysics {
   glm::vec3 position;
   glm::vec2 velocity;
@@ -28,7 +46,7 @@ struct RaftPhysics {
   int probes;
   RaftPhysics(glm::vec3 position, glm::vec3 scale, float mass, int probes);
   void update(float deltaTime, float time);
-  std::vector<ForceApplication2> computeForces(float time);
+  RaftForces computeForces(float time);
   float torqueFromForce(ForceApplication2 applied);
 };
 
@@ -36,18 +54,33 @@ struct RaftPart {
   glm::vec3 position;
   glm::vec2 velocity;
   glm::vec3 scale;
-  float rotation;
+  glm::vec2 direction;
   float mass;
   RaftPart(const glm::vec3 &position, const glm::vec2 &velocity,
-           const glm::vec3 &scale, float rotation, float mass);
+           const glm::vec3 &scale, glm::vec2 direction, float mass);
   ForceApplication2 weight();
-  ForceApplication2 buoyancy(float time);
-  ForceApplication2 drag(float time);
+  ForceApplication2 buoyancy(float waveHeight);
+  ForceApplication2 drag(float waveHeight);
 };
 
+// Per-raft kernels shared by RaftPhysics and RaftWorld, so both step a raft
+// through exactly the same arithmetic. None of them touch the heap.
+RaftPart raftProbe(const RaftFrame &frame, const glm::vec3 &position,
+                   const glm::vec2 &velocity, float angularVelocity,
+                   int probes, int i);
+void raftAccumulate(RaftForces &forces, const glm::vec3 &position,
+                    glm::vec2 direction, float mass, ForceApplication2 applied);
+float raftTorque(const glm::vec3 &position, glm::vec2 direction,
+                 ForceApplication2 applied);
+void raftIntegrate(glm::vec3 &position, glm::vec2 &velocity, float &rotation,
+                   float &angularVelocity, const glm::vec3 &scale, float mass,
+                   RaftForces forces, float deltaTime);
+
 glm::vec2 map2D(glm::vec3 v);
 glm::vec3 map3D(glm::vec2 v);
 float acuteAngle(const glm::vec2 &a, const glm::vec2 &b);
+// Drag coefficient of a flat plate inclined at angle radians to the flow.
+float dragCoefficient(float angle);
 
 extern const glm::vec3 gravity;
 extern const Material water;
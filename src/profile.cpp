@@ -0,0 +1,112 @@
+#include "profile.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+static const auto epoch = std::chrono::steady_clock::now();
+
+// Tracks in registration order, which is also their trace thread id.
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ProfileTrack>> registry;
+static thread_local ProfileTrack *threadTrack = nullptr;
+
+ProfileTrack::ProfileTrack(std::string name)
+    : name(std::move(name)), spans(new ProfileSpan[capacity]), head(0) {}
+
+void ProfileTrack::record(const char *name, long long begin, long long end) {
+  auto index = head.load(std::memory_order_relaxed);
+  spans[index & (capacity - 1)] = {name, begin, end};
+  head.store(index + 1, std::memory_order_release);
+}
+
+long long profileNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+ProfileTrack *profileTrack(const std::string &name) {
+  auto lock = std::lock_guard<std::mutex>(registryMutex);
+  registry.push_back(std::make_unique<ProfileTrack>(name));
+  return registry.back().get();
+}
+
+ProfileTrack *profileThread(const char *name) {
+  if (threadTrack == nullptr)
+    threadTrack = profileTrack(name);
+  return threadTrack;
+}
+
+ProfileScope::ProfileScope(const char *name)
+    : track(profileThread()), name(name), begin(profileNow()) {}
+
+ProfileScope::~ProfileScope() { track->record(name, begin, profileNow()); }
+
+// Span names come from the code, so only quotes and backslashes need care.
+static void writeName(std::ostream &out, const std::string &name) {
+  out << '"';
+  for (auto c : name) {
+    if (c == '"' or c == '\\')
+      out << '\\';
+    out << c;
+  }
+  out << '"';
+}
+
+// A producer may overwrite the oldest spans while they are being copied, so
+// the head is read again afterwards and whatever it could have reached is
+// dropped.
+static std::vector<ProfileSpan> snapshot(const ProfileTrack &track) {
+  auto end = track.head.load(std::memory_order_acquire);
+  auto begin = end > (unsigned long long)ProfileTrack::capacity
+                   ? end - ProfileTrack::capacity
+                   : 0ull;
+  auto spans = std::vector<ProfileSpan>();
+  for (auto i = begin; i < end; ++i)
+    spans.push_back(track.spans[i & (ProfileTrack::capacity - 1)]);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  auto after = track.head.load(std::memory_order_relaxed);
+  auto overwritten = after > (unsigned long long)ProfileTrack::capacity
+                         ? after - ProfileTrack::capacity
+                         : 0ull;
+  if (overwritten > begin)
+    spans.erase(spans.begin(),
+                spans.begin() +
+                    (long)std::min<unsigned long long>(overwritten - begin,
+                                                       spans.size()));
+  return spans;
+}
+
+bool profileWriteTrace(const std::string &path) {
+  auto file = std::ofstream(path);
+  if (not file) {
+    lg.error("failed to open trace file ", path, "\n");
+    return false;
+  }
+  auto lock = std::lock_guard<std::mutex>(registryMutex);
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  auto first = true;
+  auto spanCount = 0ll;
+  for (auto tid = 0; tid < (int)registry.size(); ++tid) {
+    auto &track = *registry[tid];
+    file << (first ? "" : ",") << "\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+         << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+    writeName(file, track.name);
+    file << "}}";
+    first = false;
+    for (auto &span : snapshot(track)) {
+      file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"name\":";
+      writeName(file, span.name);
+      file << ",\"ts\":" << span.begin / 1e3
+           << ",\"dur\":" << (span.end - span.begin) / 1e3 << "}";
+      ++spanCount;
+    }
+  }
+  file << "\n]}\n";
+  lg.info("wrote ", spanCount, " profile spans to ", path, "\n");
+  return (bool)file;
+}
@@ -0,0 +1,50 @@
+#ifndef SURFACES_PROFILE_HPP
+#define SURFACES_PROFILE_HPP
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Timeline of named spans, one track per thread plus any others asked for,
+// such as the GPU. Each track is a fixed ring written only by its own
+// producer, so recording takes no lock and never allocates. When a ring
+// wraps, the oldest spans are lost. writeTrace() can run at any time from any
+// thread and saves what the rings hold as Chrome trace_event JSON, for
+// chrome://tracing or Perfetto.
+struct ProfileSpan {
+  const char *name; // must outlive the profiler, as string literals do
+  long long begin;  // ns since profileNow() started counting
+  long long end;
+};
+
+struct ProfileTrack {
+  explicit ProfileTrack(std::string name);
+  // Only one thread may record into a track.
+  void record(const char *name, long long begin, long long end);
+  static const int capacity = 1 << 16;
+  std::string name;
+  std::unique_ptr<ProfileSpan[]> spans;
+  std::atomic<unsigned long long> head;
+};
+
+long long profileNow();
+// A new track, kept until exit. Registering takes a lock; recording does not.
+ProfileTrack *profileTrack(const std::string &name);
+// The calling thread's track, registered on first use under name.
+ProfileTrack *profileThread(const char *name = "worker");
+bool profileWriteTrace(const std::string &path);
+
+// Records the enclosing scope on the calling thread's track.
+struct ProfileScope {
+  explicit ProfileScope(const char *name);
+  ~ProfileScope();
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  ProfileTrack *track;
+  const char *name;
+  long long begin;
+};
+
+#endif // SURFACES_PROFILE_HPP
@@ -0,0 +1,174 @@
+#include "programcache.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// Tokens from GL 4.1, which the 3.3 headers do not define.
+static const GLenum programBinaryRetrievableHint = 0x8257;
+static const GLenum programBinaryLength = 0x8741;
+static const GLenum numProgramBinaryFormats = 0x87FE;
+static const GLenum programBinaryFormats = 0x87FF;
+
+// Start of every cache file. The key guards against renamed files, and the
+// format is what glProgramBinary needs back.
+struct EntryHeader {
+  char magic[8];
+  unsigned long long key;
+  GLenum format;
+  GLint length;
+};
+static const char entryMagic[8] = "SFPROG1";
+
+static bool hasExtension(const char *name) {
+  auto count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (auto i = 0; i < count; ++i)
+    if (not strcmp((const char *)glGetStringi(GL_EXTENSIONS, i), name))
+      return true;
+  return false;
+}
+
+// 64-bit FNV-1a.
+static unsigned long long hashBytes(unsigned long long hash,
+                                    const std::string &bytes) {
+  for (auto byte : bytes) {
+    hash ^= (unsigned char)byte;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+ProgramCache::ProgramCache(const std::string &directory)
+    : hits(0), misses(0), rejected(0), stored(0), directory(directory),
+      driver(), formats(), getProgramBinary(nullptr), programBinary(nullptr),
+      programParameteri(nullptr) {
+  for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    auto text = (const char *)glGetString(name);
+    driver += std::string(text != nullptr ? text : "") + "\n";
+  }
+  auto major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  if (major * 10 + minor < 41 and
+      not hasExtension("GL_ARB_get_program_binary"))
+    return;
+  auto get = (GetProgramBinaryProc)xprocAddress("glGetProgramBinary");
+  auto put = (ProgramBinaryProc)xprocAddress("glProgramBinary");
+  auto parameter = (ProgramParameteriProc)xprocAddress("glProgramParameteri");
+  if (get == nullptr or put == nullptr or parameter == nullptr)
+    return;
+  auto count = 0;
+  glGetIntegerv(numProgramBinaryFormats, &count);
+  if (count <= 0)
+    return;
+  formats.resize(count);
+  glGetIntegerv(programBinaryFormats, formats.data());
+  getProgramBinary = get;
+  programBinary = put;
+  programParameteri = parameter;
+}
+
+bool ProgramCache::available() const { return programBinary != nullptr; }
+
+unsigned long long ProgramCache::key(const std::string &vertexSource,
+                                     const std::string &fragmentSource) const {
+  auto hash = 0xcbf29ce484222325ull;
+  hash = hashBytes(hash, driver);
+  hash = hashBytes(hash, std::string(1, '\0') + vertexSource);
+  hash = hashBytes(hash, std::string(1, '\0') + fragmentSource);
+  return hash;
+}
+
+std::string ProgramCache::path(unsigned long long key) const {
+  auto name = std::ostringstream();
+  name << directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+       << key << ".bin";
+  return name.str();
+}
+
+bool ProgramCache::load(Program &program, const std::string &vertexSource,
+                        const std::string &fragmentSource) {
+  if (not available()) {
+    ++misses;
+    return false;
+  }
+  auto entryKey = key(vertexSource, fragmentSource);
+  auto file = std::ifstream(path(entryKey), std::ios::binary);
+  auto header = EntryHeader();
+  if (not file.read((char *)&header, sizeof(header)) or
+      memcmp(header.magic, entryMagic, sizeof(entryMagic)) != 0 or
+      header.key != entryKey or header.length <= 0 or
+      std::find(formats.begin(), formats.end(), (GLint)header.format) ==
+          formats.end()) {
+    ++misses;
+    return false;
+  }
+  auto binary = std::vector<char>(header.length);
+  if (not file.read(binary.data(), header.length)) {
+    ++misses;
+    return false;
+  }
+  programBinary(program.id, header.format, binary.data(), header.length);
+  auto success = 0;
+  glGetProgramiv(program.id, GL_LINK_STATUS, &success);
+  if (not success) {
+    ++rejected;
+    return false;
+  }
+  ++hits;
+  return true;
+}
+
+void ProgramCache::prepare(Program &program) {
+  if (available())
+    programParameteri(program.id, programBinaryRetrievableHint, GL_TRUE);
+}
+
+// Written to a temporary file and renamed into place, so a crash or a second
+// instance never leaves a torn entry behind.
+void ProgramCache::store(Program &program, const std::string &vertexSource,
+                         const std::string &fragmentSource) {
+  if (not available())
+    return;
+  auto length = 0;
+  glGetProgramiv(program.id, programBinaryLength, &length);
+  if (length <= 0)
+    return;
+  auto binary = std::vector<char>(length);
+  auto format = GLenum(0);
+  getProgramBinary(program.id, length, &length, &format, binary.data());
+  auto entryKey = key(vertexSource, fragmentSource);
+  auto header = EntryHeader{{}, entryKey, format, length};
+  memcpy(header.magic, entryMagic, sizeof(entryMagic));
+  auto error = std::error_code();
+  std::filesystem::create_directories(directory, error);
+  auto target = path(entryKey);
+  auto temporary = target + ".tmp";
+  {
+    auto file = std::ofstream(temporary, std::ios::binary | std::ios::trunc);
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), length);
+    if (not file)
+      return;
+  }
+  std::filesystem::rename(temporary, target, error);
+  if (not error)
+    ++stored;
+}
+
+void ProgramCache::report() const {
+  if (not available()) {
+    lg.info("program cache: no program binary support, compiled ", misses,
+            " programs\n");
+    return;
+  }
+  lg.info("program cache: ", hits, " hits, ", misses, " misses, ", rejected,
+          " rejected by the driver, ", stored, " stored in ", directory,
+          "\n");
+}
+
+ProgramCache *programCache = nullptr;
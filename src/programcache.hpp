@@ -0,0 +1,50 @@
+#ifndef SURFACES_PROGRAMCACHE_HPP
+#define SURFACES_PROGRAMCACHE_HPP
+
+#include "xgl.hpp"
+#include <string>
+#include <vector>
+
+// On-disk cache of linked programs. It uses glGetProgramBinary and
+// glProgramBinary, from GL 4.1 or ARB_get_program_binary. The 3.3 loader
+// does not cover those, so they are looked up at runtime. Entries are keyed
+// by a hash of both shader sources plus the GL vendor, renderer and version
+// strings, so an edited shader or a new driver just misses. A binary the
+// driver refuses is also a miss. On a miss the caller compiles from source,
+// then stores the result for next time.
+//
+// Needs a current context. Without driver support every load() misses and
+// store() does nothing.
+struct ProgramCache {
+  explicit ProgramCache(const std::string &directory);
+  bool available() const;
+  bool load(Program &program, const std::string &vertexSource,
+            const std::string &fragmentSource);
+  // Call before linking a program that is going to be stored.
+  void prepare(Program &program);
+  void store(Program &program, const std::string &vertexSource,
+             const std::string &fragmentSource);
+  void report() const;
+  int hits, misses, rejected, stored;
+
+private:
+  typedef void(APIENTRYP GetProgramBinaryProc)(GLuint, GLsizei, GLsizei *,
+                                                GLenum *, void *);
+  typedef void(APIENTRYP ProgramBinaryProc)(GLuint, GLenum, const void *,
+                                             GLsizei);
+  typedef void(APIENTRYP ProgramParameteriProc)(GLuint, GLenum, GLint);
+  unsigned long long key(const std::string &vertexSource,
+                         const std::string &fragmentSource) const;
+  std::string path(unsigned long long key) const;
+  std::string directory;
+  std::string driver;
+  std::vector<GLint> formats;
+  GetProgramBinaryProc getProgramBinary;
+  ProgramBinaryProc programBinary;
+  ProgramParameteriProc programParameteri;
+};
+
+// Programs built from source go through this cache when it is set.
+extern ProgramCache *programCache;
+
+#endif // SURFACES_PROGRAMCACHE_HPP
@@ -1,28 +1,58 @@
 #include "raft.hpp"
 #include "math.hpp"
-#include "models.hpp"
 #include "physics.hpp"
-#include "xgl.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+static glm::mat4 raftModel(glm::vec3 position, float rotation,
+                           glm::vec3 scale) {
+  auto model = glm::mat4(1.0f);
+  model = glm::translate(model, position);
+  model = glm::rotate(model, -rotation, glm::vec3(1.0f, 0.0f, 0.0f));
+  return glm::scale(model, scale);
+}
+
 Raft::Raft(glm::vec3 position, const Material &material, glm::vec3 scale,
-           int probes, const std::string &vertName, const std::string &fragName,
-           CubeVertices &cubev)
-    : cubev(cubev), shader(shaderProgramFromAsset(vertName, fragName)),
-      upv(shader.locateUniform("trans_pv")),
-      umodel(shader.locateUniform("trans_model")),
-      physics(position, scale, material.density * volume(scale), probes) {}
+           int probes)
+    : physics(position, scale, material.density * volume(scale), probes),
+      previousPosition(position), previousRotation(0.0f) {}
 void Raft::update(float deltaTime, float time) {
+  previousPosition = physics.position;
+  previousRotation = physics.rotation;
   physics.update(deltaTime, time);
 }
-void Raft::draw(const glm::mat4 &transPV) {
-  auto model = glm::mat4(1.0f);
-  model = glm::translate(model, physics.position);
-  model = glm::rotate(model, -physics.rotation, glm::vec3(1.0f, 0.0f, 0.0f));
-  model = glm::scale(model, physics.scale);
-  shader.use();
-  upv = transPV;
-  umodel = model;
-  cubev.draw();
+// Blends the last two physics states, alpha being how far the rendered frame
+// is from the previous step towards the current one.
+void Raft::draw(CubeBatch &batch, float alpha) {
+  auto position = glm::mix(previousPosition, physics.position, alpha);
+  auto rotation = glm::mix(previousRotation, physics.rotation, alpha);
+  batch.add(raftModel(position, rotation, physics.scale), glm::vec3(1.0f));
+}
+
+RaftFleet::RaftFleet(int count, glm::vec3 corner, float spacing,
+                     const Material &material, glm::vec3 scale, int probes)
+    : world(), previousPosition(), previousRotation() {
+  auto side = 1;
+  while (side * side < count)
+    ++side;
+  for (auto i = 0; i < count; ++i)
+    world.add(corner + spacing * glm::vec3(i % side, 0.0f, i / side), scale,
+              material.density * volume(scale), probes);
+  world.finish();
+  previousPosition = world.position;
+  previousRotation = world.rotation;
+}
+// Copying into vectors of the same size reuses their storage, so this stays
+// free of allocations like world.step().
+void RaftFleet::update(float deltaTime, float time) {
+  previousPosition = world.position;
+  previousRotation = world.rotation;
+  world.step(deltaTime, time);
+}
+void RaftFleet::draw(CubeBatch &batch, float alpha) {
+  for (auto i = 0; i < world.size(); ++i)
+    batch.add(raftModel(glm::mix(previousPosition[i], world.position[i], alpha),
+                        glm::mix(previousRotation[i], world.rotation[i], alpha),
+                        world.scale[i]),
+              glm::vec3(1.0f));
 }
\ No newline at end of file
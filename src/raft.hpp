@@ -1,19 +1,30 @@
 #ifndef SURFACES_RAFT_HPP
 #define SURFACES_RAFT_HPP
 
-#include "models.hpp"
+#include "cubebatch.hpp"
 #include "physics.hpp"
+#include "world.hpp"
 
 struct Raft {
-  CubeVertices &cubev;
-  Program shader;
-  Uniform upv, umodel;
   RaftPhysics physics;
+  glm::vec3 previousPosition;
+  float previousRotation;
   Raft(glm::vec3 position, const Material &material, glm::vec3 scale,
-       int probes, const std::string &vertPath, const std::string &fragPath,
-       CubeVertices &cubev);
+       int probes);
   void update(float deltaTime, float time);
-  void draw(const glm::mat4 &transPV);
+  void draw(CubeBatch &batch, float alpha);
+};
+
+// A square of count rafts spaced spacing apart from corner, stepped together
+// in a RaftWorld. Like Raft it keeps the previous state so draw() can blend.
+struct RaftFleet {
+  RaftWorld world;
+  std::vector<glm::vec3> previousPosition;
+  std::vector<float> previousRotation;
+  RaftFleet(int count, glm::vec3 corner, float spacing,
+            const Material &material, glm::vec3 scale, int probes);
+  void update(float deltaTime, float time);
+  void draw(CubeBatch &batch, float alpha);
 };
 
 #endif // SURFACES_RAFT_HPP
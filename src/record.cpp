@@ -0,0 +1,100 @@
+#include "record.hpp"
+#include "lg.hpp"
+#include <cstdlib>
+#include <cstring>
+
+// Start of every log; the settings follow in the same struct.
+struct LogHeader {
+  char magic[8];
+  float physicsRate;
+  int maxSubsteps;
+  unsigned char ocean, jonswap;
+  int rafts;
+};
+static const char logMagic[8] = "SFINPT1";
+
+// Start of every frame, followed by cursorCount x and y pairs.
+struct FrameHeader {
+  float time;
+  unsigned short keys;
+  unsigned short cursorCount;
+  unsigned long long checksum;
+};
+
+static_assert((int)InputKey::count <= 16, "keys must fit FrameHeader::keys");
+
+int InputFrame::key(InputKey key) const { return keys >> (int)key & 1; }
+
+float InputFrame::axis(InputKey positive, InputKey negative) const {
+  return (float)key(positive) - (float)key(negative);
+}
+
+InputRecorder::InputRecorder(const std::string &path,
+                             const InputSettings &settings)
+    : frames(0), path(path), file(path, std::ios::binary | std::ios::trunc) {
+  auto header = LogHeader{{},
+                          settings.physicsRate,
+                          settings.maxSubsteps,
+                          settings.ocean,
+                          settings.jonswap,
+                          settings.rafts};
+  memcpy(header.magic, logMagic, sizeof(logMagic));
+  if (not file.write((const char *)&header, sizeof(header))) {
+    lg.error("failed to open input log ", path, "\n");
+    std::exit(1);
+  }
+}
+
+void InputRecorder::frame(const InputFrame &input,
+                          unsigned long long checksum) {
+  auto header = FrameHeader{input.time, (unsigned short)input.keys,
+                            (unsigned short)input.cursor.size(), checksum};
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)input.cursor.data(),
+             header.cursorCount * sizeof(glm::vec2));
+  if (not file) {
+    lg.error("failed to write input log ", path, "\n");
+    std::exit(1);
+  }
+  ++frames;
+}
+
+InputPlayer::InputPlayer(const std::string &path)
+    : settings(), frames(0), path(path), file(path, std::ios::binary) {
+  auto header = LogHeader();
+  if (not file.read((char *)&header, sizeof(header)) or
+      memcmp(header.magic, logMagic, sizeof(logMagic)) != 0) {
+    lg.error("not an input log: ", path, "\n");
+    std::exit(1);
+  }
+  settings = InputSettings{header.physicsRate, header.maxSubsteps,
+                           header.ocean != 0, header.jonswap != 0,
+                           header.rafts};
+}
+
+bool InputPlayer::next(InputFrame &input, unsigned long long &checksum) {
+  auto header = FrameHeader();
+  if (not file.read((char *)&header, sizeof(header)))
+    return false;
+  input.time = header.time;
+  input.keys = header.keys;
+  input.cursor.resize(header.cursorCount);
+  if (not file.read((char *)input.cursor.data(),
+                    header.cursorCount * sizeof(glm::vec2))) {
+    lg.error("input log ", path, " ends inside frame ", frames, "\n");
+    return false;
+  }
+  checksum = header.checksum;
+  ++frames;
+  return true;
+}
+
+unsigned long long hashFloats(unsigned long long hash, const float *values,
+                              size_t count) {
+  auto bytes = (const unsigned char *)values;
+  for (auto i = (size_t)0; i < count * sizeof(float); ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
@@ -0,0 +1,81 @@
+#ifndef SURFACES_RECORD_HPP
+#define SURFACES_RECORD_HPP
+
+#include <fstream>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Keys main.cpp polls each frame, one bit each in InputFrame::keys.
+enum class InputKey {
+  escape,
+  pause,
+  transparent,
+  wireframe,
+  physicsDebug,
+  slowmo,
+  trace,
+  right,
+  left,
+  up,
+  down,
+  backward,
+  forward,
+  count
+};
+
+// Everything from outside the program that one frame of the main loop reads:
+// the time handed to Time::handle(), the polled keys, and the cursor
+// positions delivered since the previous frame, in order.
+struct InputFrame {
+  float time;
+  unsigned keys;
+  std::vector<glm::vec2> cursor;
+  // 1 if the key is down, like glfwGetKey() returning GLFW_PRESS.
+  int key(InputKey key) const;
+  // 1, -1 or 0 as one, the other or neither of the keys is down.
+  float axis(InputKey positive, InputKey negative) const;
+};
+
+// The options the physics depends on, stored ahead of the frames so a replay
+// sets up the same scene.
+struct InputSettings {
+  float physicsRate;
+  int maxSubsteps;
+  bool ocean;
+  bool jonswap;
+  int rafts;
+};
+
+// Writes a log of frames, each with the checksum of the physics state it led
+// to. A frame with no cursor events takes 16 bytes.
+struct InputRecorder {
+  InputRecorder(const std::string &path, const InputSettings &settings);
+  void frame(const InputFrame &input, unsigned long long checksum);
+  int frames;
+
+private:
+  std::string path;
+  std::ofstream file;
+};
+
+// Reads back what InputRecorder wrote.
+struct InputPlayer {
+  explicit InputPlayer(const std::string &path);
+  // False once the log is used up.
+  bool next(InputFrame &input, unsigned long long &checksum);
+  InputSettings settings;
+  int frames;
+
+private:
+  std::string path;
+  std::ifstream file;
+};
+
+// 64-bit FNV-1a over the bytes of the floats, so any change in any bit of the
+// state shows.
+unsigned long long hashFloats(unsigned long long hash, const float *values,
+                              size_t count);
+const auto hashStart = 0xcbf29ce484222325ull;
+
+#endif // SURFACES_RECORD_HPP
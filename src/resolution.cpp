@@ -0,0 +1,126 @@
+#include "resolution.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Timings that need this many frames to settle before the scale moves again,
+// the weight of each new one, and how far under budget the next step up has
+// to be predicted.
+static const int settleSamples = 4;
+static const double smoothing = 0.25;
+static const double headroom = 0.85;
+
+Resolution::Resolution(float fixedScale, float budgetMs)
+    : scale(fixedScale > 0.0f ? fixedScale : 1.0f),
+      dynamic(not(fixedScale > 0.0f)), budgetMs(budgetMs), changes(0),
+      allocated(0), frames(0), scaleSum(0.0), pool(), timings(), step(steps),
+      next(0), oldest(0), timing(false), smoothedMs(0.0), samples(0) {
+  pool.reserve(poolSize);
+  if (not dynamic)
+    return;
+  for (auto &slot : timings) {
+    glGenQueries(1, &slot.begin);
+    glGenQueries(1, &slot.end);
+    slot.step = 0;
+    slot.pending = false;
+  }
+}
+
+// Timings are collected here rather than in begin(), so that a step they
+// cause already sizes this frame, and end() tags the frame with the step it
+// really rendered at.
+Inter &Resolution::target(int width, int height) {
+  if (dynamic)
+    collect();
+  ++frames;
+  scaleSum += scale;
+  width = std::max((int)std::lround(width * scale), 1);
+  height = std::max((int)std::lround(height * scale), 1);
+  for (auto &pooled : pool)
+    if (pooled.inter.width == width and pooled.inter.height == height) {
+      pooled.used = frames;
+      return pooled.inter;
+    }
+  if ((int)pool.size() >= poolSize) {
+    auto stale = std::min_element(
+        pool.begin(), pool.end(),
+        [](const Pooled &a, const Pooled &b) { return a.used < b.used; });
+    stale->inter.free();
+    pool.erase(stale);
+  }
+  ++allocated;
+  pool.push_back({Inter(width, height), frames});
+  return pool.back().inter;
+}
+
+// A frame whose slot is still in flight goes unmeasured.
+void Resolution::begin() {
+  if (not dynamic)
+    return;
+  timing = not timings[next].pending;
+  if (timing)
+    glQueryCounter(timings[next].begin, GL_TIMESTAMP);
+}
+
+void Resolution::end() {
+  if (not timing)
+    return;
+  auto &slot = timings[next];
+  glQueryCounter(slot.end, GL_TIMESTAMP);
+  slot.step = step;
+  slot.pending = true;
+  next = (next + 1) % timingCount;
+  timing = false;
+}
+
+void Resolution::collect() {
+  while (timings[oldest].pending) {
+    auto &slot = timings[oldest];
+    auto available = 0;
+    glGetQueryObjectiv(slot.end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (not available)
+      break;
+    auto begun = GLuint64(0);
+    auto ended = GLuint64(0);
+    glGetQueryObjectui64v(slot.begin, GL_QUERY_RESULT, &begun);
+    glGetQueryObjectui64v(slot.end, GL_QUERY_RESULT, &ended);
+    slot.pending = false;
+    oldest = (oldest + 1) % timingCount;
+    if (slot.step == step)
+      measured((ended - begun) / 1e6);
+  }
+}
+
+// GPU time goes roughly with the pixel count, the square of the scale.
+void Resolution::measured(double ms) {
+  smoothedMs = samples == 0 ? ms : smoothedMs + smoothing * (ms - smoothedMs);
+  if (++samples < settleSamples)
+    return;
+  auto target = step;
+  if (smoothedMs > budgetMs and step > minStep) {
+    auto fit = (int)(step * std::sqrt(budgetMs / smoothedMs));
+    target = std::clamp(fit, minStep, step - 1);
+  } else if (smoothedMs <= budgetMs and step < steps) {
+    auto grown = (double)(step + 1) / step;
+    if (smoothedMs * grown * grown < headroom * budgetMs)
+      target = step + 1;
+  }
+  if (target == step)
+    return;
+  step = target;
+  scale = (float)step / steps;
+  samples = 0;
+  ++changes;
+}
+
+void Resolution::report() const {
+  if (frames == 0)
+    return;
+  if (not dynamic) {
+    lg.info("resolution: fixed scale ", scale, "\n");
+    return;
+  }
+  lg.info("resolution: mean scale ", scaleSum / frames, ", last ", scale, ", ",
+          changes, " changes for a ", budgetMs, " ms budget, ", allocated,
+          " targets allocated\n");
+}
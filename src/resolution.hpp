@@ -0,0 +1,63 @@
+#ifndef SURFACES_RESOLUTION_HPP
+#define SURFACES_RESOLUTION_HPP
+
+#include "inter.hpp"
+#include <vector>
+
+// Dynamic resolution. The scene renders into an Inter of scale times the
+// window size, which the screen pass stretches over the window. A fixed
+// scale is just that. Otherwise each frame's GPU time is measured between two
+// timestamp queries, read back frames later as GLTimers does, and scale moves
+// in steps of 1 / steps to keep it under budgetMs. It goes down at once by as
+// many steps as the measured time asks for, and up one step at a time, only
+// when the next step is predicted to leave some headroom, so that it settles
+// instead of flipping between two steps.
+//
+// Targets are pooled by size. Moving between neighbouring steps, the common
+// case, reuses them; a new size frees the least recently used one once the
+// pool is full.
+struct Resolution {
+  // A fixedScale of 0 lets the scale follow budgetMs.
+  Resolution(float fixedScale, float budgetMs);
+  Resolution(const Resolution &) = delete;
+  Resolution &operator=(const Resolution &) = delete;
+  // The target for this frame of a width x height window. Call once a
+  // frame, before begin().
+  Inter &target(int width, int height);
+  // Bracket the GPU work of a frame.
+  void begin();
+  void end();
+  void report() const;
+  float scale;
+  bool dynamic;
+  float budgetMs;
+  int changes;     // steps taken
+  int allocated;   // targets created
+  int frames;      // targets handed out
+  double scaleSum; // scale over those frames
+
+private:
+  struct Pooled {
+    Inter inter;
+    int used; // frame last handed out
+  };
+  struct Timing {
+    unsigned begin, end;
+    int step; // the scale the frame rendered at
+    bool pending;
+  };
+  static const int steps = 16;
+  static const int minStep = 8;
+  static const int poolSize = 4;
+  static const int timingCount = 4;
+  void collect();
+  void measured(double ms);
+  std::vector<Pooled> pool;
+  Timing timings[timingCount];
+  int step, next, oldest;
+  bool timing; // whether this frame got a timing
+  double smoothedMs;
+  int samples; // timings at the current step
+};
+
+#endif // SURFACES_RESOLUTION_HPP
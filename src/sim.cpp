@@ -0,0 +1,289 @@
+#include "alloc.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include "math.hpp"
+#include "ocean.hpp"
+#include "physics.hpp"
+#include "wave.hpp"
+#include "wavefield.hpp"
+#include "world.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+// Headless fixed-step driver for the raft physics. Links neither GLFW nor GL,
+// so it runs on machines without a display and gives a throughput number with
+// no renderer in the loop.
+
+struct SimOptions {
+  int rafts = 1000;
+  int steps = 1000;
+  int probes = 8;
+  float rate = 480.0f; // 240 lets the default rafts diverge
+  bool world = true;
+  int threads = 1;
+  bool deterministic = true;
+  bool collisions = true;
+  float spacing = 15.0f;
+  float waveSpacing = 0.0f;
+  int waveTile = 8;
+  bool ocean = false;
+  OceanSettings oceanSettings;
+};
+
+static SimOptions parseOptions(int argc, char **argv) {
+  auto options = SimOptions();
+  for (auto i = 1; i < argc; ++i) {
+    auto flag = argv[i];
+    if (i + 1 >= argc) {
+      lg.error("missing value for ", flag, "\n");
+      std::exit(1);
+    }
+    auto value = argv[++i];
+    if (not strcmp(flag, "--rafts"))
+      options.rafts = std::atoi(value);
+    else if (not strcmp(flag, "--steps"))
+      options.steps = std::atoi(value);
+    else if (not strcmp(flag, "--probes"))
+      options.probes = std::atoi(value);
+    else if (not strcmp(flag, "--rate"))
+      options.rate = (float)std::atof(value);
+    else if (not strcmp(flag, "--threads"))
+      options.threads = std::atoi(value);
+    else if (not strcmp(flag, "--deterministic"))
+      options.deterministic = std::atoi(value) != 0;
+    else if (not strcmp(flag, "--collisions"))
+      options.collisions = std::atoi(value) != 0;
+    else if (not strcmp(flag, "--spacing"))
+      options.spacing = (float)std::atof(value);
+    else if (not strcmp(flag, "--wave-spacing"))
+      options.waveSpacing = (float)std::atof(value);
+    else if (not strcmp(flag, "--wave-tile"))
+      options.waveTile = std::atoi(value);
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "sines"))
+      options.ocean = false;
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "phillips"))
+      options.ocean = true, options.oceanSettings.jonswap = false;
+    else if (not strcmp(flag, "--ocean") and not strcmp(value, "jonswap"))
+      options.ocean = true, options.oceanSettings.jonswap = true;
+    else if (not strcmp(flag, "--ocean-size"))
+      options.oceanSettings.size = std::atoi(value);
+    else if (not strcmp(flag, "--ocean-length"))
+      options.oceanSettings.length = (float)std::atof(value);
+    else if (not strcmp(flag, "--mode") and not strcmp(value, "world"))
+      options.world = true;
+    else if (not strcmp(flag, "--mode") and not strcmp(value, "rafts"))
+      options.world = false;
+    else {
+      lg.error("unknown flag ", flag, "\n");
+      std::exit(1);
+    }
+  }
+  return options;
+}
+
+static glm::vec3 spawnPosition(const SimOptions &options, int i) {
+  auto side = 1;
+  while (side * side < options.rafts)
+    ++side;
+  return {500.0f + options.spacing * (i % side), 10.0f,
+          500.0f + options.spacing * (i / side)};
+}
+
+static const auto raftScale = glm::vec3(10.0f, 0.5f, 10.0f);
+
+// Steps one RaftPhysics object per raft through the per-raft update().
+static double runRafts(const SimOptions &options, double &seconds) {
+  auto rafts = std::vector<RaftPhysics>();
+  for (auto i = 0; i < options.rafts; ++i)
+    rafts.emplace_back(spawnPosition(options, i), raftScale,
+                       wood.density * volume(raftScale), options.probes);
+  auto deltaTime = 1.0f / options.rate;
+  auto time = 0.0f;
+  auto start = std::chrono::steady_clock::now();
+  for (auto step = 0; step < options.steps; ++step) {
+    time += deltaTime;
+    auto guard = AllocationGuard("raft step", step > 0);
+    if (ocean != nullptr)
+      ocean->update(time);
+    for (auto &raft : rafts)
+      raft.update(deltaTime, time);
+  }
+  auto end = std::chrono::steady_clock::now();
+  seconds = std::chrono::duration<double>(end - start).count();
+  auto checksum = 0.0;
+  for (auto &raft : rafts)
+    checksum += raft.position.y + raft.position.z + raft.rotation;
+  return checksum;
+}
+
+// Steps the same rafts stored in a RaftWorld with one step() per frame,
+// summing the collider's per-step counters into collisions and the tiles
+// filled by field, if there is one, into tiles.
+static double runWorld(const SimOptions &options, double &seconds,
+                       CollisionStats &collisions, WaveField *field,
+                       long long &tiles) {
+  auto world = RaftWorld();
+  world.collisions = options.collisions;
+  world.waveField = field;
+  for (auto i = 0; i < options.rafts; ++i)
+    world.add(spawnPosition(options, i), raftScale,
+              wood.density * volume(raftScale), options.probes);
+  world.finish();
+  auto deltaTime = 1.0f / options.rate;
+  auto time = 0.0f;
+  auto start = std::chrono::steady_clock::now();
+  for (auto step = 0; step < options.steps; ++step) {
+    time += deltaTime;
+    auto guard = AllocationGuard("world step", step > 0);
+    if (ocean != nullptr)
+      ocean->update(time);
+    world.step(deltaTime, time);
+    auto &stats = world.collider.stats;
+    collisions.rebinned += stats.rebinned;
+    collisions.candidates += stats.candidates;
+    collisions.contacts += stats.contacts;
+    collisions.broadphaseNs += stats.broadphaseNs;
+    collisions.narrowphaseNs += stats.narrowphaseNs;
+    if (field != nullptr)
+      tiles += field->stats.tiles;
+  }
+  auto end = std::chrono::steady_clock::now();
+  seconds = std::chrono::duration<double>(end - start).count();
+  auto checksum = 0.0;
+  for (auto i = 0; i < world.size(); ++i)
+    checksum +=
+        world.position[i].y + world.position[i].z + world.rotation[i];
+  return checksum;
+}
+
+// Largest difference between the batched wave kernel and waveHeightAtPoint
+// over the area the rafts were spawned in.
+static float waveKernelError(const SimOptions &options, float time) {
+  auto corner = spawnPosition(options, options.rafts - 1);
+  auto xs = std::vector<float>(), zs = std::vector<float>();
+  for (auto i = 0; i < 64; ++i) {
+    for (auto j = 0; j < 64; ++j) {
+      xs.push_back(glm::mix(500.0f, corner.x + options.spacing, i / 63.0f));
+      zs.push_back(glm::mix(500.0f, corner.z + options.spacing, j / 63.0f));
+    }
+  }
+  auto heights = std::vector<float>(xs.size());
+  waveHeights(xs.data(), zs.data(), heights.data(), (int)xs.size(), time);
+  auto error = 0.0f;
+  for (auto i = 0; i < (int)xs.size(); ++i)
+    error = std::max(error, std::abs(heights[i] - waveHeightAtPoint(
+                                                      {xs[i], 0.0f, zs[i]},
+                                                      time)));
+  return error;
+}
+
+// Largest difference between field and waveHeightAtPoint over the same area,
+// sampled off the field's grid.
+static float waveFieldError(const SimOptions &options, WaveField &field,
+                            float time) {
+  auto corner = spawnPosition(options, options.rafts - 1);
+  auto xs = std::vector<float>(), zs = std::vector<float>();
+  for (auto i = 0; i < 64; ++i) {
+    for (auto j = 0; j < 64; ++j) {
+      xs.push_back(glm::mix(500.0f, corner.x + options.spacing, i / 63.0f) +
+                   0.37f * field.spacing());
+      zs.push_back(glm::mix(500.0f, corner.z + options.spacing, j / 63.0f) +
+                   0.61f * field.spacing());
+    }
+  }
+  auto heights = std::vector<float>(xs.size());
+  field.heights(xs.data(), zs.data(), heights.data(), (int)xs.size(), time);
+  auto error = 0.0f;
+  for (auto i = 0; i < (int)xs.size(); ++i)
+    error = std::max(error, std::abs(heights[i] - waveHeightAtPoint(
+                                                      {xs[i], 0.0f, zs[i]},
+                                                      time)));
+  return error;
+}
+
+// Mean time of one Ocean::update() and the significant wave height, four
+// standard deviations of the surface height, of the last one.
+static double oceanUpdateTime(Ocean &ocean, float time, float &waveHeight) {
+  auto updates = 20;
+  auto start = std::chrono::steady_clock::now();
+  for (auto i = 0; i < updates; ++i)
+    ocean.update(time);
+  auto end = std::chrono::steady_clock::now();
+  auto mean = 0.0, square = 0.0;
+  for (auto h : ocean.height)
+    mean += h, square += h * h;
+  mean /= ocean.height.size();
+  square /= ocean.height.size();
+  waveHeight = (float)(4 * std::sqrt(square - mean * mean));
+  return std::chrono::duration<double>(end - start).count() / updates;
+}
+
+int main(int argc, char **argv) {
+  auto options = parseOptions(argc, argv);
+  auto jobSystem = JobSystem(options.threads, options.deterministic);
+  ::jobs = &jobSystem;
+  auto oceanSurface = std::unique_ptr<Ocean>();
+  if (options.ocean) {
+    oceanSurface = std::make_unique<Ocean>(options.oceanSettings);
+    ::ocean = oceanSurface.get();
+  }
+  auto seconds = 0.0;
+  auto collisions = CollisionStats();
+  auto field = std::unique_ptr<WaveField>();
+  if (options.waveSpacing > 0.0f)
+    field = std::make_unique<WaveField>(options.waveSpacing, options.waveTile);
+  auto tiles = 0ll;
+  auto checksum =
+      options.world
+          ? runWorld(options, seconds, collisions, field.get(), tiles)
+          : runRafts(options, seconds);
+  // Throughput measured on a state that blew up means nothing.
+  if (not std::isfinite(checksum)) {
+    lg.error("raft state diverged to ", checksum,
+             "; the step is too long for these rafts, try a higher --rate\n");
+    std::exit(1);
+  }
+  auto raftSteps = (double)options.rafts * options.steps;
+  lg.info(options.rafts, " rafts x ", options.steps, " steps (",
+          options.world ? "world" : "rafts", ", ", options.probes,
+          " probes, dt ", 1.0f / options.rate, ", ", jobSystem.threadCount(),
+          options.deterministic ? " deterministic" : "", " threads) in ",
+          seconds, " s\n");
+  lg.info("steps/sec: ", options.steps / seconds, "\n");
+  lg.info("ns per raft-step: ", 1e9 * seconds / raftSteps, "\n");
+  if (options.world and options.collisions) {
+    auto steps = (double)options.steps;
+    lg.info("collisions per step: ", collisions.candidates / steps,
+            " candidates, ", collisions.contacts / steps, " contacts, ",
+            collisions.rebinned / steps, " rebinned, broadphase ",
+            collisions.broadphaseNs / steps / 1e3, " us, narrowphase ",
+            collisions.narrowphaseNs / steps / 1e3, " us\n");
+  }
+  if (ocean != nullptr) {
+    auto waveHeight = 0.0f;
+    auto update =
+        oceanUpdateTime(*ocean, options.steps / options.rate, waveHeight);
+    lg.info("ocean: ", options.oceanSettings.jonswap ? "jonswap" : "phillips",
+            ", ", ocean->size(), "^2 grid over ", ocean->length(), " m, ",
+            1e6 * update, " us per update, significant wave height ",
+            waveHeight, " m\n");
+  }
+  lg.info("wave kernel: ", waveKernelName(), ", max error vs scalar ",
+          waveKernelError(options, options.steps / options.rate), "\n");
+  if (options.world and field) {
+    auto time = options.steps / options.rate;
+    lg.info("wave field: ", field->spacing(), " m spacing, ",
+            field->tileCells(), " cells per tile, ",
+            (double)tiles / options.steps, " tiles per step, max error vs ",
+            "analytic ", waveFieldError(options, *field, time), "\n");
+  }
+  lg.info("checksum: ", std::setprecision(17), checksum, "\n");
+  return 0;
+}
@@ -2,18 +2,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-Sun::Sun(glm::vec3 position, glm::vec3 scale, const std::string &vertName,
-         const std::string &fragName, CubeVertices &cubev)
-    : cubev(cubev), shader(shaderProgramFromAsset(vertName, fragName)),
-      upv(shader.locateUniform("trans_pv")),
-      umodel(shader.locateUniform("trans_model")), position(position),
-      scale(scale) {}
-void Sun::draw(const glm::mat4 &transPV) {
+Sun::Sun(glm::vec3 position, glm::vec3 scale)
+    : position(position), scale(scale) {}
+void Sun::draw(CubeBatch &batch) {
   auto model = glm::mat4(1.0f);
   model = glm::translate(model, position);
   model = glm::scale(model, scale);
-  shader.use();
-  upv = transPV;
-  umodel = model;
-  cubev.draw();
+  batch.add(model, glm::vec3(1.0f));
 }
\ No newline at end of file
@@ -1,10 +1,31 @@
 #include "time.hpp"
+#include <algorithm>
 
-Time::Time() : camera{0.0f, 0.0f}, physics{0.0f, 0.0f}, last(0.0f) {}
+Time::Time(float physicsRate, int maxSubsteps)
+    : camera{0.0f, 0.0f}, physics{0.0f, 0.0f},
+      fixed{1.0f / physicsRate, maxSubsteps, 0, 0, 0.0f, 0.0f}, last(0.0f) {}
 
 void Time::handle(bool paused, bool slowmo, float global) {
   camera.delta = global - camera.current;
   camera.current = global;
   physics.delta = paused ? 0.0f : (slowmo ? 0.025f : 1.0f) * camera.delta;
-  physics.current += physics.delta;
+  fixed.accumulator += physics.delta;
+  fixed.substeps = (int)(fixed.accumulator / fixed.step);
+  if (fixed.substeps > fixed.maxSubsteps) {
+    fixed.substeps = fixed.maxSubsteps;
+    fixed.accumulator = fixed.step * fixed.substeps;
+  }
+  fixed.accumulator -= fixed.step * fixed.substeps;
+  fixed.accumulator = std::max(fixed.accumulator, 0.0f);
+  fixed.ticks += fixed.substeps;
+  fixed.alpha = std::min(fixed.accumulator / fixed.step, 1.0f);
+  physics.current =
+      (float)(((double)fixed.ticks - 1 + fixed.alpha) * fixed.step);
+}
+
+// Simulation time at the end of this frame's given substep. Derived from the
+// step counter rather than summed, so runs at the same rate see the same times.
+float Time::stepTime(int substep) const {
+  return (float)((double)(fixed.ticks - fixed.substeps + substep + 1) *
+                 fixed.step);
 }
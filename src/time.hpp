@@ -6,12 +6,28 @@ struct Clock {
   float current;
 };
 
+// Physics advances in steps of a fixed length, however long frames take. The
+// scaled frame time is accumulated and drained in whole steps, at most
+// maxSubsteps of them per frame (the backlog beyond that is dropped rather
+// than letting a slow frame snowball), and alpha says how far the rendered
+// frame lies between the last two physics states.
+struct FixedStep {
+  float step;
+  int maxSubsteps;
+  long long ticks;
+  int substeps;
+  float accumulator;
+  float alpha;
+};
+
 struct Time {
   Clock camera;
   Clock physics;
+  FixedStep fixed;
   float last;
-  Time();
+  Time(float physicsRate, int maxSubsteps);
   void handle(bool paused, bool slowmo, float global);
+  float stepTime(int substep) const;
 };
 
 #endif // SURFACES_TIME_HPP
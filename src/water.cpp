@@ -1,48 +1,104 @@
 #include "water.hpp"
+#include "camera.hpp"
+#include "lg.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-Water::Water(int width, int depth, const std::string &vertName,
-             const std::string &fragName, glm::vec3 sunPos)
-    : vao(), vbo(), ebo(), shader(shaderProgramFromAsset(vertName, fragName)),
+// Tiles along each side of a level, and the range of them left out of every
+// level but the first.
+static const int tilesPerSide = 8;
+static const int holeBegin = 2;
+static const int holeEnd = 6;
+// Fraction of a level's half width after which its vertices start morphing.
+static const float morphStart = 0.75f;
+// Per tile: origin x and z, vertex spacing, morph start and end.
+static const int instanceFloats = 5;
+// Bound on waveHeightAtPoint: 4 times a sum of three sines.
+static const float analyticAmplitude = 12.0f;
+
+Water::Water(WaterPatch patch, int levels, float spacing,
+             const std::string &vertName, const std::string &fragName,
+             glm::vec3 sunPos)
+    : vao(), instanceVbo(), ebo(),
+      shader(shaderProgramFromAsset(vertName, fragName)),
       utime(shader.locateUniform("time")),
       upv(shader.locateUniform("trans_pv")),
       umodel(shader.locateUniform("trans_model")),
-      uviewpos(shader.locateUniform("view_pos")), vertices(),
-      indices((unsigned)2 * 3 * width * depth) {
-  for (auto x = 0; x < width + 1; ++x) {
-    for (auto z = 0; z < depth + 1; ++z) {
-      vertices.push_back((float)x);
-      vertices.push_back(0);
-      vertices.push_back((float)z);
-      if (x < width and z < depth) {
-        indices[3 * (x * depth + z)] = ((unsigned)((width + 1) * x + z));
-        indices[3 * (x * depth + z) + 1] =
-            ((unsigned)((width + 1) * x + z + 1));
-        indices[3 * (x * depth + z) + 2] =
-            ((unsigned)((width + 1) * (x + 1) + z));
-        indices[3 * (x * depth + z) + 3 * width * depth] =
-            ((unsigned)((width + 1) * x + z + 1));
-        indices[3 * (x * depth + z) + 3 * width * depth + 1] =
-            ((unsigned)((width + 1) * (x + 1) + z));
-        indices[3 * (x * depth + z) + 3 * width * depth + 2] =
-            ((unsigned)((width + 1) * (x + 1) + z + 1));
-      }
-    }
+      uviewpos(shader.locateUniform("view_pos")),
+      uuseocean(shader.locateUniform("use_ocean")),
+      uoceanlength(shader.locateUniform("ocean_length")),
+      ulodcenter(shader.locateUniform("lod_center")), oceanMap(),
+      oceanSize(0), oceanTexels(), indexCount(patch.indexCount),
+      halfIndexCount(patch.halfIndexCount), instances(),
+      amplitude(analyticAmplitude), reach(0.0f), visibleTiles(0),
+      triangles(0), patchSize(patch.patchSize), levels(levels),
+      spacing(spacing) {
+  if (levels < 1) {
+    lg.error("water needs at least one level, got ", levels, "\n");
+    std::exit(1);
   }
-
+  lg.info("water patch ACMR ", patch.acmrBefore, " -> ", patch.acmrAfter,
+          ", transparent ", patch.halfAcmrBefore, " -> ", patch.halfAcmrAfter,
+          "\n");
   vao.bind();
-  vbo.xbindAndBufferStatic(vertices);
-  ebo.xbindAndBufferStatic(indices);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float),
+  ebo.xbindAndBufferStatic(patch.indices);
+  instances.reserve(instanceFloats * tilesPerSide * tilesPerSide * levels);
+  instanceVbo.xbindAndBufferStream(nullptr, (unsigned)instances.capacity());
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+                        instanceFloats * sizeof(float),
                         (void *)(0 * sizeof(float)));
-  glEnableVertexAttribArray(0);
+  glVertexAttribDivisor(1, 1);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+                        instanceFloats * sizeof(float),
+                        (void *)(3 * sizeof(float)));
+  glVertexAttribDivisor(2, 1);
+  glEnableVertexAttribArray(2);
 
   shader.use();
   umodel = glm::mat4(1.0f);
   shader.locateUniform("sun.pos") = sunPos;
   shader.locateUniform("sun.color") = glm::vec3(1.0f);
+  shader.locateUniform("ocean_map") = 0;
+  shader.locateUniform("patch_size") = patchSize;
+  uuseocean = 0;
+}
+
+// Packs height and displacement into one RGB float texel per grid point.
+void Water::upload(const Ocean &ocean) {
+  auto size = ocean.size();
+  oceanTexels.resize((size_t)3 * size * size);
+  amplitude = reach = 0.0f;
+  for (auto i = 0; i < size * size; ++i) {
+    oceanTexels[3 * i] = ocean.height[i];
+    oceanTexels[3 * i + 1] = ocean.displacementX[i];
+    oceanTexels[3 * i + 2] = ocean.displacementZ[i];
+    amplitude = std::max(amplitude, std::abs(ocean.height[i]));
+    reach = std::max({reach, std::abs(ocean.displacementX[i]),
+                      std::abs(ocean.displacementZ[i])});
+  }
+  oceanMap.bind(GL_TEXTURE_2D);
+  if (size != oceanSize) {
+    oceanMap.image2D(GL_TEXTURE_2D, 0, GL_RGB32F, size, size, 0, GL_RGB,
+                     GL_FLOAT, oceanTexels.data());
+    oceanMap.parameter(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    oceanMap.parameter(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    oceanMap.parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    oceanMap.parameter(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    oceanSize = size;
+  } else {
+    oceanMap.subImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGB, GL_FLOAT,
+                        oceanTexels.data());
+  }
+  oceanMap.unbind(GL_TEXTURE_2D);
+  shader.use();
+  uuseocean = 1;
+  uoceanlength = ocean.length();
 }
+
 void Water::draw(float time, const glm::mat4 &transPV, glm::vec3 viewPos,
                  bool transparent) {
   vao.bind();
@@ -50,7 +106,49 @@ void Water::draw(float time, const glm::mat4 &transPV, glm::vec3 viewPos,
   utime = time;
   upv = transPV;
   uviewpos = viewPos;
-  glDrawElements(GL_TRIANGLES, (unsigned)indices.size() / (transparent ? 2 : 1),
-                 GL_UNSIGNED_INT, nullptr);
-  vao.unbind();
+  if (oceanSize > 0)
+    oceanMap.xactivateAndBind(GL_TEXTURE0, GL_TEXTURE_2D);
+  auto snap = 2 * spacing * (float)(1 << (levels - 1));
+  auto center = snap * glm::vec2(std::round(viewPos.x / snap),
+                                 std::round(viewPos.z / snap));
+  ulodcenter = center;
+  auto frustum = Frustum(transPV);
+  instances.clear();
+  for (auto level = 0; level < levels; ++level) {
+    auto levelSpacing = spacing * (float)(1 << level);
+    auto tileSize = (float)patchSize * levelSpacing;
+    auto half = tileSize * tilesPerSide / 2;
+    // Morphing completes a step inside the edge, so rounding cannot leave
+    // the edge itself short of the coarser grid. The outermost level has
+    // nothing to blend into and gets a range past its edge.
+    auto last = level + 1 == levels;
+    auto start = last ? 2 * half : morphStart * half;
+    auto end = last ? 3 * half : half - levelSpacing;
+    for (auto tx = 0; tx < tilesPerSide; ++tx) {
+      for (auto tz = 0; tz < tilesPerSide; ++tz) {
+        if (level > 0 and tx >= holeBegin and tx < holeEnd and
+            tz >= holeBegin and tz < holeEnd)
+          continue;
+        auto origin = center + tileSize * glm::vec2(tx - tilesPerSide / 2,
+                                                    tz - tilesPerSide / 2);
+        auto min = glm::vec3(origin.x - reach, -amplitude, origin.y - reach);
+        auto max = glm::vec3(origin.x + tileSize + reach, amplitude,
+                             origin.y + tileSize + reach);
+        if (not frustum.intersects(min, max))
+          continue;
+        instances.insert(instances.end(),
+                         {origin.x, origin.y, levelSpacing, start, end});
+      }
+    }
+  }
+  auto count = (unsigned)(transparent ? halfIndexCount : indexCount);
+  auto offset = transparent ? indexCount * sizeof(unsigned short) : 0;
+  visibleTiles = (int)instances.size() / instanceFloats;
+  triangles = visibleTiles * (int)count / 3;
+  if (visibleTiles > 0) {
+    instanceVbo.xbindAndBufferStream(instances.data(),
+                                     (unsigned)instances.size());
+    glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_SHORT,
+                            (void *)offset, visibleTiles);
+  }
 }
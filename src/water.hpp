@@ -1,18 +1,51 @@
 #ifndef SURFACES_WATER_HPP
 #define SURFACES_WATER_HPP
 
+#include "ocean.hpp"
+#include "waterpatch.hpp"
 #include "xgl.hpp"
 
+// Geometry clipmap around the camera. The mesh is a single square patch of
+// patchSize x patchSize quads, instanced once per tile with the tile's
+// position, vertex spacing and morph range as per-instance attributes. Level 0
+// is 8 x 8 tiles spaced spacing apart; every further level doubles the spacing
+// and draws the 48 tiles around the 4 x 4 hole the level inside it fills. All
+// levels share a centre snapped to twice the coarsest spacing, so vertices only
+// ever move by whole grid steps and the surface does not swim as the camera
+// moves. The outer quarter of each level morphs its odd vertices onto the next
+// level's grid, which closes the seams between them.
+//
+// Tiles whose bounds, grown by the largest wave, miss the view frustum are
+// not drawn; the rest go out in one instanced draw call. visibleTiles and
+// triangles count what the last draw() submitted.
+//
+// Until upload() is first called the surface is the analytic wave, evaluated
+// in the vertex shader; afterwards it follows the uploaded ocean grids, which
+// tile across the sea.
 struct Water {
   VAO vao;
-  VBO vbo;
+  VBO instanceVbo;
   EBO ebo;
   Program shader;
-  Uniform utime, upv, umodel, uviewpos;
-  std::vector<float> vertices;
-  std::vector<unsigned> indices;
-  Water(int width, int depth, const std::string &vertName,
-        const std::string &fragName, glm::vec3 sunPos);
+  Uniform utime, upv, umodel, uviewpos, uuseocean, uoceanlength;
+  Uniform ulodcenter;
+  Texture oceanMap;
+  int oceanSize;
+  std::vector<float> oceanTexels;
+  int indexCount;
+  int halfIndexCount;
+  std::vector<float> instances;
+  float amplitude; // largest wave height, in either direction
+  float reach;     // largest horizontal displacement
+  int visibleTiles;
+  int triangles;
+  int patchSize;
+  int levels;
+  float spacing;
+  Water(WaterPatch patch, int levels, float spacing,
+        const std::string &vertName, const std::string &fragName,
+        glm::vec3 sunPos);
+  void upload(const Ocean &ocean);
   void draw(float time, const glm::mat4 &transPV, glm::vec3 viewPos,
             bool transparent);
 };
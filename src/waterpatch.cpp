@@ -0,0 +1,52 @@
+#include "waterpatch.hpp"
+#include "lg.hpp"
+#include "meshopt.hpp"
+#include <cstdlib>
+
+// FIFO depth the reported cache miss ratios are measured with.
+static const int acmrCacheSize = 16;
+
+WaterPatch::WaterPatch(int patchSize)
+    : patchSize(patchSize),
+      indices((unsigned)2 * 3 * patchSize * patchSize), indexCount(0),
+      halfIndexCount(0), acmrBefore(0.0f), acmrAfter(0.0f),
+      halfAcmrBefore(0.0f), halfAcmrAfter(0.0f) {
+  // Morphing moves odd vertices onto even ones, which needs tile corners on
+  // even vertices, and indices are 16 bits.
+  if (patchSize < 2 or patchSize % 2 != 0 or patchSize > 254) {
+    lg.error("water needs an even patch size up to 254, got ", patchSize,
+             "\n");
+    std::exit(1);
+  }
+  // Vertex (x, z) is number (width + 1) * x + z; the vertex shader recovers
+  // its coordinates from gl_VertexID, so there is no vertex buffer.
+  auto width = patchSize, depth = patchSize;
+  for (auto x = 0; x < width; ++x) {
+    for (auto z = 0; z < depth; ++z) {
+      auto quad = 3 * (x * depth + z);
+      auto corner = (unsigned short)((width + 1) * x + z);
+      auto next = (unsigned short)(corner + width + 1);
+      indices[quad] = corner;
+      indices[quad + 1] = corner + 1;
+      indices[quad + 2] = next;
+      indices[quad + 3 * width * depth] = corner + 1;
+      indices[quad + 3 * width * depth + 1] = next;
+      indices[quad + 3 * width * depth + 2] = next + 1;
+    }
+  }
+
+  // The transparent mode draws only the first triangle of each quad, so
+  // those get their own copy, ordered for the cache on their own, after the
+  // whole patch.
+  auto half = std::vector<unsigned short>(
+      indices.begin(), indices.begin() + (long)indices.size() / 2);
+  acmrBefore = acmr(indices, acmrCacheSize);
+  halfAcmrBefore = acmr(half, acmrCacheSize);
+  optimizeVertexCache(indices, (width + 1) * (depth + 1));
+  optimizeVertexCache(half, (width + 1) * (depth + 1));
+  acmrAfter = acmr(indices, acmrCacheSize);
+  halfAcmrAfter = acmr(half, acmrCacheSize);
+  indexCount = (int)indices.size();
+  halfIndexCount = (int)half.size();
+  indices.insert(indices.end(), half.begin(), half.end());
+}
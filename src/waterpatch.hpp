@@ -0,0 +1,21 @@
+#ifndef SURFACES_WATERPATCH_HPP
+#define SURFACES_WATERPATCH_HPP
+
+#include <vector>
+
+// Index buffer contents for Water's patch of patchSize x patchSize quads,
+// ordered for the vertex cache. Building it needs no GL context, so it can be
+// done off the context thread: indexCount indices for the whole patch, then
+// halfIndexCount for the transparent mode's half.
+struct WaterPatch {
+  explicit WaterPatch(int patchSize);
+  int patchSize;
+  std::vector<unsigned short> indices;
+  int indexCount;
+  int halfIndexCount;
+  // Average cache miss ratios before and after ordering, as acmr() gives them.
+  float acmrBefore, acmrAfter;
+  float halfAcmrBefore, halfAcmrAfter;
+};
+
+#endif // SURFACES_WATERPATCH_HPP
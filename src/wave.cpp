@@ -1,5 +1,11 @@
 #include "wave.hpp"
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SURFACES_WAVE_X86
+#endif
 
 float waveHeightAtPoint(glm::vec3 vertex_pos, float time) {
   float wavePresence = (sin((vertex_pos.x + vertex_pos.z + time) / 16) + 1) / 2;
@@ -7,3 +13,205 @@ float waveHeightAtPoint(glm::vec3 vertex_pos, float time) {
   float height = 4 * wavePresence * (sin(x) + sin(2 * x) + sin(3 * x));
   return height;
 }
+
+// The vector kernels evaluate the same formula as waveHeightAtPoint, but
+// replace the four libm calls with one shared sincos and one sin. Arguments
+// are reduced to [-pi/4, pi/4] around the nearest multiple of pi/2 using a
+// three-part Cody-Waite split of pi/2, and the remainders go through the
+// Cephes single precision minimax polynomials (about 1 ulp on that interval).
+// sin(2x) and sin(3x) come from the double and triple angle identities.
+//
+// Error bound, measured over |x|, |z| <= 4096 and time <= 3600: the kernels
+// stay within 3e-6 of the formula evaluated exactly on the same float inputs,
+// and within 1e-3 of waveHeightAtPoint. The latter is almost entirely the
+// scalar path's own error, which rounds 3 * x to float before taking its sine
+// and so is off by up to 4 * ulp(3x) / 2; it shrinks to 2.5e-4 for |x|, |z| <=
+// 1024 and time <= 600.
+
+static const float reducePi2A = 1.5703125f;
+static const float reducePi2B = 4.837512969970703125e-4f;
+static const float reducePi2C = 7.54978995489188216e-8f;
+static const float sinC1 = -1.6666654611e-1f;
+static const float sinC2 = 8.3321608736e-3f;
+static const float sinC3 = -1.9515295891e-4f;
+static const float cosC1 = 4.166664568298827e-2f;
+static const float cosC2 = -1.388731625493765e-3f;
+static const float cosC3 = 2.443315711809948e-5f;
+
+static void waveHeightsScalar(const float *x, const float *z, float *heights,
+                              int n, float time) {
+  for (auto i = 0; i < n; ++i)
+    heights[i] = waveHeightAtPoint({x[i], 0.0f, z[i]}, time);
+}
+
+#ifdef SURFACES_WAVE_X86
+
+static inline void sincosSse(__m128 x, __m128 &s, __m128 &c) {
+  auto q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772367581f)));
+  auto qf = _mm_cvtepi32_ps(q);
+  auto r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(reducePi2A)));
+  r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(reducePi2B)));
+  r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(reducePi2C)));
+  auto r2 = _mm_mul_ps(r, r);
+  auto ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sinC3), r2), _mm_set1_ps(sinC2));
+  ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(sinC1));
+  ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+  auto pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cosC3), r2), _mm_set1_ps(cosC2));
+  pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(cosC1));
+  pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+  pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(_mm_set1_ps(0.5f), r2)),
+                  _mm_set1_ps(1.0f));
+  auto swap = _mm_castsi128_ps(
+      _mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+  auto signS = _mm_castsi128_ps(_mm_slli_epi32(q, 30));
+  signS = _mm_and_ps(signS, _mm_set1_ps(-0.0f));
+  auto signC = _mm_castsi128_ps(
+      _mm_slli_epi32(_mm_add_epi32(q, _mm_set1_epi32(1)), 30));
+  signC = _mm_and_ps(signC, _mm_set1_ps(-0.0f));
+  s = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+  c = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+  s = _mm_xor_ps(s, signS);
+  c = _mm_xor_ps(c, signC);
+}
+
+static inline __m128 waveHeightSse(__m128 x, __m128 z, __m128 time) {
+  __m128 presence, unused, s1, c1;
+  auto a = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, z), time), _mm_set1_ps(0.0625f));
+  sincosSse(a, presence, unused);
+  presence = _mm_mul_ps(_mm_add_ps(presence, _mm_set1_ps(1.0f)),
+                        _mm_set1_ps(0.5f));
+  auto u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(0.125f)),
+                                 _mm_mul_ps(x, _mm_set1_ps(0.03125f))),
+                      _mm_mul_ps(time, _mm_set1_ps(0.5f)));
+  sincosSse(u, s1, c1);
+  auto s2 = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(2.0f), s1), c1);
+  auto s3 = _mm_mul_ps(
+      s1, _mm_sub_ps(_mm_set1_ps(3.0f),
+                     _mm_mul_ps(_mm_set1_ps(4.0f), _mm_mul_ps(s1, s1))));
+  auto sum = _mm_add_ps(_mm_add_ps(s1, s2), s3);
+  return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), presence), sum);
+}
+
+static void waveHeightsSse(const float *x, const float *z, float *heights,
+                           int n, float time) {
+  auto t = _mm_set1_ps(time);
+  auto i = 0;
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(heights + i,
+                  waveHeightSse(_mm_loadu_ps(x + i), _mm_loadu_ps(z + i), t));
+  if (i < n) {
+    alignas(16) float tx[4] = {}, tz[4] = {}, th[4];
+    std::memcpy(tx, x + i, (n - i) * sizeof(float));
+    std::memcpy(tz, z + i, (n - i) * sizeof(float));
+    _mm_store_ps(th, waveHeightSse(_mm_load_ps(tx), _mm_load_ps(tz), t));
+    std::memcpy(heights + i, th, (n - i) * sizeof(float));
+  }
+}
+
+__attribute__((target("avx2,fma"))) static inline void
+sincosAvx2(__m256 x, __m256 &s, __m256 &c) {
+  auto q = _mm256_cvtps_epi32(
+      _mm256_mul_ps(x, _mm256_set1_ps(0.636619772367581f)));
+  auto qf = _mm256_cvtepi32_ps(q);
+  auto r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(reducePi2A), x);
+  r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(reducePi2B), r);
+  r = _mm256_fnmadd_ps(qf, _mm256_set1_ps(reducePi2C), r);
+  auto r2 = _mm256_mul_ps(r, r);
+  auto ps = _mm256_fmadd_ps(_mm256_set1_ps(sinC3), r2, _mm256_set1_ps(sinC2));
+  ps = _mm256_fmadd_ps(ps, r2, _mm256_set1_ps(sinC1));
+  ps = _mm256_fmadd_ps(_mm256_mul_ps(ps, r2), r, r);
+  auto pc = _mm256_fmadd_ps(_mm256_set1_ps(cosC3), r2, _mm256_set1_ps(cosC2));
+  pc = _mm256_fmadd_ps(pc, r2, _mm256_set1_ps(cosC1));
+  pc = _mm256_mul_ps(_mm256_mul_ps(pc, r2), r2);
+  pc = _mm256_add_ps(_mm256_fnmadd_ps(_mm256_set1_ps(0.5f), r2, pc),
+                     _mm256_set1_ps(1.0f));
+  auto swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+      _mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+  auto signMask = _mm256_set1_ps(-0.0f);
+  auto signS =
+      _mm256_and_ps(_mm256_castsi256_ps(_mm256_slli_epi32(q, 30)), signMask);
+  auto signC = _mm256_and_ps(
+      _mm256_castsi256_ps(
+          _mm256_slli_epi32(_mm256_add_epi32(q, _mm256_set1_epi32(1)), 30)),
+      signMask);
+  s = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, swap), signS);
+  c = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, swap), signC);
+}
+
+__attribute__((target("avx2,fma"))) static inline __m256
+waveHeightAvx2(__m256 x, __m256 z, __m256 time) {
+  __m256 presence, unused, s1, c1;
+  auto a = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(x, z), time),
+                         _mm256_set1_ps(0.0625f));
+  sincosAvx2(a, presence, unused);
+  presence = _mm256_mul_ps(_mm256_add_ps(presence, _mm256_set1_ps(1.0f)),
+                           _mm256_set1_ps(0.5f));
+  auto u =
+      _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(z, _mm256_set1_ps(0.125f)),
+                                  _mm256_mul_ps(x, _mm256_set1_ps(0.03125f))),
+                    _mm256_mul_ps(time, _mm256_set1_ps(0.5f)));
+  sincosAvx2(u, s1, c1);
+  auto s2 = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), s1), c1);
+  auto s3 = _mm256_mul_ps(
+      s1, _mm256_fnmadd_ps(_mm256_set1_ps(4.0f), _mm256_mul_ps(s1, s1),
+                           _mm256_set1_ps(3.0f)));
+  auto sum = _mm256_add_ps(_mm256_add_ps(s1, s2), s3);
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(4.0f), presence), sum);
+}
+
+__attribute__((target("avx2,fma"))) static void
+waveHeightsAvx2(const float *x, const float *z, float *heights, int n,
+                float time) {
+  auto t = _mm256_set1_ps(time);
+  auto i = 0;
+  for (; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(heights + i, waveHeightAvx2(_mm256_loadu_ps(x + i),
+                                                 _mm256_loadu_ps(z + i), t));
+  if (i < n) {
+    alignas(32) float tx[8] = {}, tz[8] = {}, th[8];
+    std::memcpy(tx, x + i, (n - i) * sizeof(float));
+    std::memcpy(tz, z + i, (n - i) * sizeof(float));
+    _mm256_store_ps(th, waveHeightAvx2(_mm256_load_ps(tx), _mm256_load_ps(tz),
+                                       t));
+    std::memcpy(heights + i, th, (n - i) * sizeof(float));
+  }
+}
+
+#endif
+
+using WaveKernel = void (*)(const float *, const float *, float *, int, float);
+
+struct WaveDispatch {
+  WaveKernel kernel;
+  const char *name;
+};
+
+// Picks the widest kernel the CPU supports. SURFACES_WAVE_KERNEL=scalar, sse
+// or avx2 forces a specific one, which is useful when benchmarking.
+static WaveDispatch selectWaveKernel() {
+  auto forced = std::getenv("SURFACES_WAVE_KERNEL");
+  auto wants = [&](const char *name) {
+    return forced == nullptr or not strcmp(forced, name);
+  };
+#ifdef SURFACES_WAVE_X86
+  __builtin_cpu_init();
+  if (wants("avx2") and __builtin_cpu_supports("avx2") and
+      __builtin_cpu_supports("fma"))
+    return {waveHeightsAvx2, "avx2"};
+  if (wants("sse"))
+    return {waveHeightsSse, "sse"};
+#endif
+  return {waveHeightsScalar, "scalar"};
+}
+
+static const WaveDispatch &waveDispatch() {
+  static const auto dispatch = selectWaveKernel();
+  return dispatch;
+}
+
+void waveHeights(const float *x, const float *z, float *heights, int n,
+                 float time) {
+  waveDispatch().kernel(x, z, heights, n, time);
+}
+
+const char *waveKernelName() { return waveDispatch().name; }
@@ -4,5 +4,11 @@
 #include <glm/vec3.hpp>
 
 float waveHeightAtPoint(glm::vec3 vertex_pos, float time);
+// Batched waveHeightAtPoint over arrays of x and z positions, dispatched at
+// runtime to the widest SIMD kernel available. See wave.cpp for the error
+// bound against the scalar path.
+void waveHeights(const float *x, const float *z, float *heights, int n,
+                 float time);
+const char *waveKernelName();
 
 #endif // SURFACES_WAVE_HPP
@@ -0,0 +1,147 @@
+#include "wavefield.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include "wave.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Points and tiles handed to each job.
+static const int pointGrain = 1024;
+static const int tileGrain = 4;
+// Keeps a fill's coordinates on the stack.
+static const int maxTileCells = 64;
+// Grid coordinates past this are treated like non-finite ones.
+static const float maxGridCoordinate = 1e9f;
+
+WaveField::WaveField(float spacing, int tileCells)
+    : stats(), cellSpacing(spacing), inverseSpacing(1.0f / spacing),
+      cells(tileCells),
+      tileSamples((tileCells + 1) * (tileCells + 1)), stamp(0),
+      stampTime(NAN), tileCount(0) {
+  if (not(spacing > 0.0f) or tileCells < 1 or tileCells > maxTileCells) {
+    lg.error("wave field needs a positive spacing and 1 to ", maxTileCells,
+             " cells per tile, got ", spacing, " and ", tileCells, "\n");
+    std::exit(1);
+  }
+}
+
+float WaveField::spacing() const { return cellSpacing; }
+
+int WaveField::tileCells() const { return cells; }
+
+// Every point lies in exactly one tile, so n points never need more than n
+// tiles at once.
+void WaveField::reserve(int points) {
+  if (points <= (int)pointTile.size())
+    return;
+  pointTile.resize(points);
+  tileX.resize(points);
+  tileZ.resize(points);
+  samples.resize((size_t)points * tileSamples);
+  auto capacity = 64;
+  while (capacity < 2 * points)
+    capacity *= 2;
+  table.assign(capacity, {0, 0, 0, -1});
+  // The old table is gone, so cached tiles are too.
+  stamp = 0;
+  stampTime = NAN;
+}
+
+// Open addressing keyed by tile coordinates. Slots from earlier time values
+// count as empty, so moving to a new time clears the table by bumping stamp.
+int WaveField::findTile(int x, int z) {
+  auto mask = (int)table.size() - 1;
+  auto slot = (int)(((unsigned)x * 0x9E3779B1u + (unsigned)z) & mask);
+  while (table[slot].stamp == stamp and
+         (table[slot].x != x or table[slot].z != z))
+    slot = (slot + 1) & mask;
+  if (table[slot].stamp == stamp)
+    return table[slot].tile;
+  if (tileCount == (int)tileX.size())
+    return -1;
+  tileX[tileCount] = x;
+  tileZ[tileCount] = z;
+  table[slot] = {x, z, stamp, tileCount};
+  return tileCount++;
+}
+
+void WaveField::fill(int tile, float time) {
+  float xs[maxTileCells + 1], zs[maxTileCells + 1];
+  for (auto b = 0; b <= cells; ++b)
+    zs[b] = (float)(tileZ[tile] * cells + b) * cellSpacing;
+  auto out = samples.data() + (size_t)tile * tileSamples;
+  for (auto a = 0; a <= cells; ++a) {
+    auto x = (float)(tileX[tile] * cells + a) * cellSpacing;
+    for (auto b = 0; b <= cells; ++b)
+      xs[b] = x;
+    waveHeights(xs, zs, out + a * (cells + 1), cells + 1, time);
+  }
+}
+
+// std::floor is a libm call without SSE4.1, and this runs twice per point.
+static int floorToInt(float v) {
+  auto i = (int)v;
+  return i - (v < (float)i);
+}
+
+static int floorDivide(int a, int b) { return (a >= 0 ? a : a - b + 1) / b; }
+
+float WaveField::sample(int tile, float x, float z) const {
+  auto gx = x * inverseSpacing - (float)(tileX[tile] * cells);
+  auto gz = z * inverseSpacing - (float)(tileZ[tile] * cells);
+  auto a = std::min(std::max(floorToInt(gx), 0), cells - 1);
+  auto b = std::min(std::max(floorToInt(gz), 0), cells - 1);
+  auto fx = gx - a, fz = gz - b;
+  auto row = samples.data() + (size_t)tile * tileSamples + a * (cells + 1) + b;
+  auto next = row + cells + 1;
+  auto near = row[0] + fz * (row[1] - row[0]);
+  auto far = next[0] + fz * (next[1] - next[0]);
+  return near + fx * (far - near);
+}
+
+void WaveField::heights(const float *x, const float *z, float *heights, int n,
+                        float time) {
+  reserve(n);
+  if (time != stampTime) {
+    ++stamp;
+    stampTime = time;
+    tileCount = 0;
+  }
+  auto filled = tileCount;
+  stats = WaveFieldStats();
+  // Finding tiles touches the shared table, so it stays on this thread. A
+  // raft's probes are neighbours in the arrays and usually share a tile, so
+  // the last tile found is checked before the table.
+  auto lastX = 0, lastZ = 0, lastTile = -1;
+  for (auto i = 0; i < n; ++i) {
+    auto gx = x[i] * inverseSpacing, gz = z[i] * inverseSpacing;
+    if (not(std::abs(gx) < maxGridCoordinate and
+            std::abs(gz) < maxGridCoordinate)) {
+      pointTile[i] = -1;
+      ++stats.fallback;
+      continue;
+    }
+    auto tx = floorDivide(floorToInt(gx), cells);
+    auto tz = floorDivide(floorToInt(gz), cells);
+    if (lastTile == -1 or tx != lastX or tz != lastZ) {
+      lastX = tx;
+      lastZ = tz;
+      lastTile = findTile(tx, tz);
+    }
+    pointTile[i] = lastTile;
+    stats.fallback += lastTile == -1;
+  }
+  stats.tiles = tileCount - filled;
+  parallelFor(stats.tiles, tileGrain, [&](int begin, int end) {
+    for (auto tile = filled + begin; tile < filled + end; ++tile)
+      fill(tile, time);
+  });
+  parallelFor(n, pointGrain, [&](int begin, int end) {
+    for (auto i = begin; i < end; ++i)
+      if (pointTile[i] == -1)
+        waveHeights(x + i, z + i, heights + i, 1, time);
+      else
+        heights[i] = sample(pointTile[i], x[i], z[i]);
+  });
+}
@@ -0,0 +1,56 @@
+#ifndef SURFACES_WAVEFIELD_HPP
+#define SURFACES_WAVEFIELD_HPP
+
+#include <vector>
+
+struct WaveFieldStats {
+  int tiles;    // tiles filled by the last heights() call
+  int fallback; // points answered by waveHeights() instead of the cache
+};
+
+// Cache of the wave heightfield for one point in time. The plane is divided
+// into square tiles of tileCells x tileCells cells, spacing metres apart, and
+// heights() fills only the tiles its points fall in, each once per time value,
+// before answering every point by bilinear interpolation. It pays off only
+// when each tile is hit by more probes than the (tileCells + 1)^2 heights it
+// costs to fill: with the batched kernel a direct evaluation is a few
+// nanoseconds, so that takes several probes per square metre of water.
+//
+// The interpolation error is bounded by the wave's curvature: about
+// 0.15 * spacing^2 metres on top of the waveHeights() kernel error, so 0.04 at
+// a 0.5 m spacing. surfaces_sim reports the measured error.
+//
+// Storage grows only when a call passes more points than any before it, so
+// repeated calls over the same probes do not allocate.
+struct WaveField {
+  WaveField(float spacing, int tileCells);
+  void heights(const float *x, const float *z, float *heights, int n,
+               float time);
+  float spacing() const;
+  int tileCells() const;
+  WaveFieldStats stats;
+
+private:
+  struct Slot {
+    int x, z;
+    unsigned stamp;
+    int tile;
+  };
+  void reserve(int points);
+  int findTile(int x, int z);
+  void fill(int tile, float time);
+  float sample(int tile, float x, float z) const;
+  float cellSpacing;
+  float inverseSpacing;
+  int cells;
+  int tileSamples;
+  unsigned stamp;
+  float stampTime;
+  int tileCount;
+  std::vector<Slot> table;
+  std::vector<int> tileX, tileZ;
+  std::vector<float> samples;
+  std::vector<int> pointTile;
+};
+
+#endif // SURFACES_WAVEFIELD_HPP
@@ -0,0 +1,116 @@
+#include "world.hpp"
+#include "debug.hpp"
+#include "jobs.hpp"
+#include "lg.hpp"
+#include "ocean.hpp"
+#include "wave.hpp"
+#include <cstdlib>
+
+// Rafts and probes handed to each job; large enough to amortize the queue
+// traffic, small enough to balance across threads.
+static const int raftGrain = 64;
+static const int probeGrain = 1024;
+// Smallest collision grid cell; the collider grows it to fit the largest raft.
+static const float collisionCellSize = 16.0f;
+
+RaftWorld::RaftWorld()
+    : collider(collisionCellSize), collisions(true), waveField(nullptr),
+      probeOffset{0}, colliderStale(false) {}
+
+int RaftWorld::add(glm::vec3 position, glm::vec3 scale, float mass,
+                   int probes) {
+  this->position.push_back(position);
+  this->velocity.emplace_back(0.0f, 0.0f);
+  this->scale.push_back(scale);
+  this->rotation.push_back(0.0f);
+  this->angularVelocity.push_back(0.0f);
+  this->mass.push_back(mass);
+  this->probes.push_back(probes);
+  frames.emplace_back(position, scale, 0.0f, mass, probes);
+  auto total = probeOffset.back() + probes;
+  probeOffset.push_back(total);
+  probeX.resize(total);
+  probeY.resize(total);
+  probeZ.resize(total);
+  probeVelocity.resize(total);
+  probeHeight.resize(total);
+  colliderStale = true;
+  return size() - 1;
+}
+
+// Separate from add() so adding many rafts resizes the collider only once.
+void RaftWorld::finish() {
+  collider.resize(scale);
+  colliderStale = false;
+}
+
+int RaftWorld::size() const { return (int)position.size(); }
+
+int RaftWorld::probeCount() const { return probeOffset.back(); }
+
+void RaftWorld::step(float deltaTime, float time) {
+  if (colliderStale and collisions) {
+    lg.error("RaftWorld::step() before finish()\n");
+    std::exit(1);
+  }
+  parallelFor(size(), raftGrain,
+              [&](int begin, int end) { gatherProbes(begin, end); });
+  if (ocean != nullptr)
+    parallelFor(probeCount(), probeGrain, [&](int begin, int end) {
+      ocean->heights(probeX.data() + begin, probeZ.data() + begin,
+                     probeHeight.data() + begin, end - begin);
+    });
+  else if (waveField != nullptr)
+    waveField->heights(probeX.data(), probeZ.data(), probeHeight.data(),
+                       probeCount(), time);
+  else
+    parallelFor(probeCount(), probeGrain, [&](int begin, int end) {
+      waveHeights(probeX.data() + begin, probeZ.data() + begin,
+                  probeHeight.data() + begin, end - begin, time);
+    });
+  // Force markers all go into the one debug queue, so recording them keeps
+  // this phase on the calling thread.
+  if (debugging())
+    integrate(0, size(), deltaTime);
+  else
+    parallelFor(size(), raftGrain,
+                [&](int begin, int end) { integrate(begin, end, deltaTime); });
+  if (not collisions)
+    return;
+  collider.step(position, velocity, scale, rotation, mass);
+}
+
+void RaftWorld::gatherProbes(int begin, int end) {
+  for (auto i = begin; i < end; ++i) {
+    frames[i] =
+        RaftFrame(position[i], scale[i], rotation[i], mass[i], probes[i]);
+    for (auto j = 0; j < probes[i]; ++j) {
+      auto part = raftProbe(frames[i], position[i], velocity[i],
+                            angularVelocity[i], probes[i], j);
+      auto k = probeOffset[i] + j;
+      probeX[k] = part.position.x;
+      probeY[k] = part.position.y;
+      probeZ[k] = part.position.z;
+      probeVelocity[k] = part.velocity;
+    }
+  }
+}
+
+void RaftWorld::integrate(int begin, int end, float deltaTime) {
+  for (auto i = begin; i < end; ++i) {
+    auto forces = RaftForces();
+    auto &frame = frames[i];
+    for (auto k = probeOffset[i]; k < probeOffset[i + 1]; ++k) {
+      auto part = RaftPart({probeX[k], probeY[k], probeZ[k]}, probeVelocity[k],
+                           frame.scalePart, frame.direction, frame.massPart);
+      raftAccumulate(forces, position[i], frame.direction, mass[i],
+                     part.weight());
+      raftAccumulate(forces, position[i], frame.direction, mass[i],
+                     part.buoyancy(probeHeight[k]));
+      raftAccumulate(forces, position[i], frame.direction, mass[i],
+                     part.drag(probeHeight[k]));
+    }
+    raftIntegrate(position[i], velocity[i], rotation[i], angularVelocity[i],
+                  scale[i], mass[i], forces, deltaTime);
+  }
+}
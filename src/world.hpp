@@ -0,0 +1,54 @@
+#ifndef SURFACES_WORLD_HPP
+#define SURFACES_WORLD_HPP
+
+#include "collision.hpp"
+#include "physics.hpp"
+#include "wavefield.hpp"
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+
+// Structure-of-arrays container for many rafts. Every field lives in its own
+// contiguous array indexed by raft, and step() walks them in tight loops
+// instead of chasing one RaftPhysics object per raft. Each phase of the step
+// is split across ::jobs when it is set; rafts are independent, so the result
+// does not depend on the thread count. Once the rafts have moved, collider
+// keeps them from passing through each other; set collisions to false to
+// leave them independent. Probes sample ::ocean when it is set; otherwise
+// they read the analytic wave from waveField when that is set, or evaluate it
+// each.
+struct RaftWorld {
+  std::vector<glm::vec3> position;
+  std::vector<glm::vec2> velocity;
+  std::vector<glm::vec3> scale;
+  std::vector<float> rotation;
+  std::vector<float> angularVelocity;
+  std::vector<float> mass;
+  std::vector<int> probes;
+  RaftCollider collider;
+  bool collisions;
+  WaveField *waveField;
+  RaftWorld();
+  int add(glm::vec3 position, glm::vec3 scale, float mass, int probes);
+  // Sizes the collider for the rafts added so far. Call it after the last
+  // add() and before step(), which never allocates.
+  void finish();
+  int size() const;
+  int probeCount() const;
+  void step(float deltaTime, float time);
+
+private:
+  void gatherProbes(int begin, int end);
+  void integrate(int begin, int end, float deltaTime);
+  // Per-raft frames and probe scratch, the latter indexed by
+  // probeOffset[raft] + probe. Both are sized by add(), so step() only
+  // overwrites them and never allocates.
+  std::vector<int> probeOffset;
+  std::vector<RaftFrame> frames;
+  std::vector<float> probeX, probeY, probeZ;
+  std::vector<glm::vec2> probeVelocity;
+  std::vector<float> probeHeight;
+  bool colliderStale; // rafts added since finish()
+};
+
+#endif // SURFACES_WORLD_HPP
@@ -1,9 +1,112 @@
 #include "xgl.hpp"
+#include "assets.hpp"
 #include "lg.hpp"
+#include "programcache.hpp"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <sstream>
 #include <stb_image.h>
+#include <unordered_map>
+
+GLCallStats glCalls = {0, 0};
+
+// Last bound object names. Binding an unknown name may not be skipped, and
+// no object is ever named ~0.
+static const unsigned unknown = ~0u;
+static const int trackedTextureUnits = 16;
+static struct BoundState {
+  BoundState() {
+    std::fill(std::begin(texture2D), std::end(texture2D), unknown);
+  }
+  unsigned program = unknown;
+  unsigned vao = unknown;
+  unsigned arrayBuffer = unknown;
+  unsigned elementBuffer = unknown; // part of the bound VAO's state
+  unsigned drawFramebuffer = unknown;
+  unsigned readFramebuffer = unknown;
+  unsigned renderbuffer = unknown;
+  GLenum activeTexture = GL_TEXTURE0;
+  unsigned texture2D[trackedTextureUnits];
+} bound;
+
+// What FBO::unbind() binds: the window's framebuffer, or an offscreen one.
+static unsigned defaultFramebuffer = 0;
+
+// Last value written to each uniform location of each program, as raw bytes.
+struct UniformValue {
+  int size = 0; // nothing written yet
+  unsigned char bytes[sizeof(glm::mat4)];
+};
+static std::unordered_map<unsigned, std::vector<UniformValue>> uniformValues;
+
+// Counts the call and records name as bound, saying whether GL needs to hear
+// about it.
+static bool changes(unsigned &cached, unsigned name) {
+  if (cached == name) {
+    ++glCalls.elided;
+    return false;
+  }
+  cached = name;
+  ++glCalls.issued;
+  return true;
+}
+
+static bool changes(const Uniform &uniform, const void *value, int size) {
+  if (uniform.id < 0) {
+    ++glCalls.elided;
+    return false;
+  }
+  auto &values = uniformValues[uniform.program];
+  if ((int)values.size() <= uniform.id)
+    values.resize(uniform.id + 1);
+  auto &last = values[uniform.id];
+  if (last.size == size and memcmp(last.bytes, value, size) == 0) {
+    ++glCalls.elided;
+    return false;
+  }
+  last.size = size;
+  memcpy(last.bytes, value, size);
+  ++glCalls.issued;
+  return true;
+}
+
+static void bindBuffer(GLenum target, unsigned id) {
+  auto tracked = target == GL_ARRAY_BUFFER           ? &bound.arrayBuffer
+                 : target == GL_ELEMENT_ARRAY_BUFFER ? &bound.elementBuffer
+                                                     : nullptr;
+  if (tracked == nullptr)
+    ++glCalls.issued;
+  else if (not changes(*tracked, id))
+    return;
+  glBindBuffer(target, id);
+}
+
+static void bindTexture(GLenum target, unsigned id) {
+  auto unit = (int)(bound.activeTexture - GL_TEXTURE0);
+  if (target != GL_TEXTURE_2D or unit >= trackedTextureUnits)
+    ++glCalls.issued;
+  else if (not changes(bound.texture2D[unit], id))
+    return;
+  glBindTexture(target, id);
+}
+
+static void bindFramebuffer(GLenum target, unsigned id) {
+  auto draw = target != GL_READ_FRAMEBUFFER;
+  auto read = target != GL_DRAW_FRAMEBUFFER;
+  if ((not draw or bound.drawFramebuffer == id) and
+      (not read or bound.readFramebuffer == id)) {
+    ++glCalls.elided;
+    return;
+  }
+  if (draw)
+    bound.drawFramebuffer = id;
+  if (read)
+    bound.readFramebuffer = id;
+  ++glCalls.issued;
+  glBindFramebuffer(target, id);
+}
 
 Shader::Shader(GLenum type) : id(glCreateShader(type)) {}
 void Shader::source(GLsizei count, const GLchar *const *text,
@@ -16,7 +119,11 @@ void Shader::source(GLsizei count, const std::string &text,
   source(count, &text2, length);
 }
 void Shader::compile() {
-  glCompileShader(id);
+  beginCompile();
+  endCompile();
+}
+void Shader::beginCompile() { glCompileShader(id); }
+void Shader::endCompile() {
   int success;
   char infoLog[512];
   glGetShaderiv(id, GL_COMPILE_STATUS, &success);
@@ -29,23 +136,36 @@ void Shader::compile() {
 void Shader::free() { glDeleteShader(id); }
 
 void Uniform::operator=(float x) {
-  glUniform1f(id, x);
+  if (changes(*this, &x, sizeof(x)))
+    glUniform1f(id, x);
 } // NOLINT(misc-unconventional-assign-operator)
 void Uniform::operator=(int x) {
-  glUniform1i(id, x);
+  if (changes(*this, &x, sizeof(x)))
+    glUniform1i(id, x);
 } // NOLINT(misc-unconventional-assign-operator)
 void Uniform::operator=(const glm::mat4 &x) {
-  glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(x));
+  if (changes(*this, &x, sizeof(x)))
+    glUniformMatrix4fv(id, 1, GL_FALSE, glm::value_ptr(x));
 } // NOLINT(misc-unconventional-assign-operator)
 void Uniform::operator=(const glm::vec2 &x) {
-  glUniform2f(id, x.x, x.y);
+  if (changes(*this, &x, sizeof(x)))
+    glUniform2f(id, x.x, x.y);
 } // NOLINT(misc-unconventional-assign-operator)
-void Uniform::operator=(const glm::vec3 &x) { glUniform3f(id, x.x, x.y, x.z); }
+void Uniform::operator=(const glm::vec3 &x) {
+  if (changes(*this, &x, sizeof(x)))
+    glUniform3f(id, x.x, x.y, x.z);
+}
 
 Program::Program() : id(glCreateProgram()) {}
 void Program::attach(const Shader &shader) { glAttachShader(id, shader.id); }
 void Program::link() {
-  glLinkProgram(id);
+  beginLink();
+  endLink();
+}
+void Program::beginLink() { glLinkProgram(id); }
+// Linking resets every uniform, so the values remembered for them go too.
+void Program::endLink() {
+  uniformValues.erase(id);
   int success;
   char infoLog[512];
   glGetProgramiv(id, GL_LINK_STATUS, &success);
@@ -56,9 +176,12 @@ void Program::link() {
   }
 }
 Uniform Program::locateUniform(const char *name) {
-  return Uniform{glGetUniformLocation(id, name)};
+  return Uniform{glGetUniformLocation(id, name), id};
+}
+void Program::use() {
+  if (changes(bound.program, id))
+    glUseProgram(id);
 }
-void Program::use() { glUseProgram(id); }
 
 Window::Window(int width, int height, const char *title, GLFWmonitor *monitor,
                GLFWwindow *share)
@@ -93,11 +216,22 @@ void Window::setWindowIcon(int count, const GLFWimage *images) {
 void Window::setWindowIcon(GLFWimage &ref) { setWindowIcon(1, &ref); }
 
 VAO::VAO() : id(0) { glGenVertexArrays(1, &id); }
-void VAO::bind() { glBindVertexArray(id); }
-void VAO::unbind() { glBindVertexArray(0); }
+void VAO::bind() {
+  if (changes(bound.vao, id)) {
+    glBindVertexArray(id);
+    bound.elementBuffer = unknown;
+  }
+}
+void VAO::unbind() {
+  if (changes(bound.vao, 0)) {
+    glBindVertexArray(0);
+    bound.elementBuffer = unknown;
+  }
+}
 
 VBO::VBO() : id(0) { glGenBuffers(1, &id); }
-void VBO::bindBuffer(GLenum target) { glBindBuffer(target, id); }
+void VBO::bindBuffer(GLenum target) { ::bindBuffer(target, id); }
+void VBO::unbind(GLenum target) { ::bindBuffer(target, 0); }
 void VBO::xbindAndBufferStatic(const std::vector<float> &vertices) {
   xbindAndBufferStatic(vertices.data(), (unsigned)vertices.size());
 }
@@ -105,9 +239,13 @@ void VBO::xbindAndBufferStatic(const float *vertices, unsigned n) {
   bindBuffer(GL_ARRAY_BUFFER);
   glBufferData(GL_ARRAY_BUFFER, n * sizeof(float), vertices, GL_STATIC_DRAW);
 }
+void VBO::xbindAndBufferStream(const float *vertices, unsigned n) {
+  bindBuffer(GL_ARRAY_BUFFER);
+  glBufferData(GL_ARRAY_BUFFER, n * sizeof(float), vertices, GL_STREAM_DRAW);
+}
 
 EBO::EBO() : id(0) { glGenBuffers(1, &id); }
-void EBO::bindBuffer(GLenum target) { glBindBuffer(target, id); }
+void EBO::bindBuffer(GLenum target) { ::bindBuffer(target, id); }
 void EBO::xbindAndBufferStatic(const std::vector<unsigned> &indices) {
   xbindAndBufferStatic(indices.data(), (unsigned)indices.size());
 }
@@ -116,6 +254,14 @@ void EBO::xbindAndBufferStatic(const unsigned *indices, unsigned n) {
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, n * sizeof(unsigned), indices,
                GL_STATIC_DRAW);
 }
+void EBO::xbindAndBufferStatic(const std::vector<unsigned short> &indices) {
+  xbindAndBufferStatic(indices.data(), (unsigned)indices.size());
+}
+void EBO::xbindAndBufferStatic(const unsigned short *indices, unsigned n) {
+  bindBuffer(GL_ELEMENT_ARRAY_BUFFER);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, n * sizeof(unsigned short), indices,
+               GL_STATIC_DRAW);
+}
 
 GLFW::GLFW() { glfwInit(); }
 void GLFW::windowHint(int hint, int value) { glfwWindowHint(hint, value); }
@@ -142,13 +288,22 @@ void Image::free() { stbi_image_free(data); }
 Image::Image() : width(0), height(0), channelCount(0), data(nullptr) {}
 
 Texture::Texture() : id(0) { glGenTextures(1, &id); }
-void Texture::bind(GLenum target) { glBindTexture(target, id); }
+void Texture::bind(GLenum target) { bindTexture(target, id); }
 void Texture::xactivateAndBind(GLenum slot, GLenum target) {
-  glActiveTexture(slot);
-  glBindTexture(target, id);
+  if (changes(bound.activeTexture, slot))
+    glActiveTexture(slot);
+  bindTexture(target, id);
 }
 
-void Texture::unbind(GLenum target) { glBindTexture(target, 0); }
+void Texture::unbind(GLenum target) { bindTexture(target, 0); }
+
+// GL unbinds a deleted object, and may hand its name out again, so the
+// cached bindings of it are forgotten.
+void Texture::free() {
+  std::replace(std::begin(bound.texture2D), std::end(bound.texture2D), id,
+               unknown);
+  glDeleteTextures(1, &id);
+}
 
 void Texture::image2D(GLenum target, GLint level, GLint internalFormat,
                       GLsizei width, GLsizei height, GLint border,
@@ -157,6 +312,13 @@ void Texture::image2D(GLenum target, GLint level, GLint internalFormat,
                type, pixels);
 }
 
+void Texture::subImage2D(GLenum target, GLint level, GLint xoffset,
+                         GLint yoffset, GLsizei width, GLsizei height,
+                         GLenum format, GLenum type, const void *pixels) {
+  glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type,
+                  pixels);
+}
+
 void Texture::parameter(GLenum target, GLenum pname, GLint param) {
   glTexParameteri(target, pname, param);
 }
@@ -173,13 +335,15 @@ std::string readFile(const std::string &path) {
   file >> oss.rdbuf();
   return oss.str();
 }
-Shader shaderFromFile(const std::string &path, GLenum type) {
-  auto src = readFile(path);
+Shader shaderFromSource(const std::string &source, GLenum type) {
   auto shader = Shader(type);
-  shader.source(1, src, nullptr);
+  shader.source(1, source, nullptr);
   shader.compile();
   return shader;
 }
+Shader shaderFromFile(const std::string &path, GLenum type) {
+  return shaderFromSource(readFile(path), type);
+}
 Program shaderProgramFromShaders(const Shader &vertex, const Shader &fragment) {
   auto program = Program();
   program.attach(vertex);
@@ -189,15 +353,30 @@ Program shaderProgramFromShaders(const Shader &vertex, const Shader &fragment) {
 }
 Program shaderProgramFromFiles(const std::string &vertexPath,
                                const std::string &fragmentPath) {
-  auto vertex = shaderFromFile(vertexPath, GL_VERTEX_SHADER);
-  auto fragment = shaderFromFile(fragmentPath, GL_FRAGMENT_SHADER);
-  auto program = shaderProgramFromShaders(vertex, fragment);
+  auto vertexSource = readFile(vertexPath);
+  auto fragmentSource = readFile(fragmentPath);
+  auto program = Program();
+  if (programCache != nullptr and
+      programCache->load(program, vertexSource, fragmentSource))
+    return program;
+  auto vertex = shaderFromSource(vertexSource, GL_VERTEX_SHADER);
+  auto fragment = shaderFromSource(fragmentSource, GL_FRAGMENT_SHADER);
+  program.attach(vertex);
+  program.attach(fragment);
+  if (programCache != nullptr)
+    programCache->prepare(program);
+  program.link();
+  if (programCache != nullptr)
+    programCache->store(program, vertexSource, fragmentSource);
   vertex.free();
   fragment.free();
   return program;
 }
 Program shaderProgramFromAsset(const std::string &vertexName,
                                const std::string &fragmentName) {
+  if (assets != nullptr)
+    if (auto program = assets->takeProgram(vertexName, fragmentName))
+      return *program;
   return shaderProgramFromFiles("shaders/" + vertexName + ".vert",
                                 "shaders/" + fragmentName + ".frag");
 }
@@ -211,18 +390,31 @@ Texture textureFromFile(const std::string &path, GLenum format) {
   glGenerateMipmap(GL_TEXTURE_2D);
   return tex;
 }
-void loadGLAD() {
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+static GLADloadproc procLoader = nullptr;
+
+void loadGLAD(GLADloadproc loader) {
+  if (!gladLoadGLLoader(loader)) {
     lg.error("failed to initialize GLAD\n");
     std::exit(-1);
   }
+  procLoader = loader;
 }
+void *xprocAddress(const char *name) { return procLoader(name); }
 
 void xclear(glm::vec3 backgroundColor, GLbitfield mask) {
   glClearColor(backgroundColor.x, backgroundColor.y, backgroundColor.z, 1.0f);
   glClear(mask);
 }
 
+void xdefaultFramebuffer(FBO &fbo) {
+  defaultFramebuffer = fbo.id;
+  bindFramebuffer(GL_FRAMEBUFFER, fbo.id);
+}
+
+void xbindDefaultFramebuffer(GLenum target) {
+  bindFramebuffer(target, defaultFramebuffer);
+}
+
 ToggleButton::ToggleButton(bool initialState)
     : state(initialState), pressed(false) {}
 bool ToggleButton::update(int keyresult) {
@@ -240,9 +432,9 @@ float ScreenInfo::aspectRatio() { return (float)width / height; }
 
 FBO::FBO() : id(0) { glGenFramebuffers(1, &id); }
 
-void FBO::bind(GLenum target) { glBindFramebuffer(target, id); }
+void FBO::bind(GLenum target) { bindFramebuffer(target, id); }
 
-void FBO::unbind(GLenum target) { glBindFramebuffer(target, 0); }
+void FBO::unbind(GLenum target) { bindFramebuffer(target, defaultFramebuffer); }
 
 void FBO::texture2D(GLenum target, GLenum attachment, GLenum textarget,
                     Texture &texture, GLint level) {
@@ -266,13 +458,33 @@ void FBO::xassertComplete(GLenum target) {
   }
 }
 
+void FBO::free() {
+  if (bound.drawFramebuffer == id)
+    bound.drawFramebuffer = unknown;
+  if (bound.readFramebuffer == id)
+    bound.readFramebuffer = unknown;
+  glDeleteFramebuffers(1, &id);
+}
+
 RBO::RBO() : id(0) { glGenRenderbuffers(1, &id); }
 
-void RBO::bind(GLenum target) { glBindRenderbuffer(target, id); }
+void RBO::bind(GLenum target) {
+  if (changes(bound.renderbuffer, id))
+    glBindRenderbuffer(target, id);
+}
 
-void RBO::unbind(GLenum target) { glBindRenderbuffer(target, 0); }
+void RBO::unbind(GLenum target) {
+  if (changes(bound.renderbuffer, 0))
+    glBindRenderbuffer(target, 0);
+}
 
 void RBO::storage(GLenum target, GLenum internalFormat, GLsizei width,
                   GLsizei height) {
   glRenderbufferStorage(target, internalFormat, width, height);
 }
+
+void RBO::free() {
+  if (bound.renderbuffer == id)
+    bound.renderbuffer = unknown;
+  glDeleteRenderbuffers(1, &id);
+}
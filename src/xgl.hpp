@@ -22,9 +22,25 @@ struct Shader {
   void source(GLsizei count, const GLchar *const *text, const GLint *length);
   void source(GLsizei count, const std::string &text, const GLint *length);
   void compile();
+  // compile() split in two, so several shaders can be compiled before the
+  // first status query waits for one of them.
+  void beginCompile();
+  void endCompile();
   void free();
   unsigned id;
 };
+// Wrapper calls that reached GL and ones skipped because the state they set
+// was already in place. The main loop clears these every frame.
+struct GLCallStats {
+  int issued;
+  int elided;
+};
+extern GLCallStats glCalls;
+
+// The wrappers below remember what they last bound and which value each
+// uniform of each program last got, and skip calls that would change
+// nothing. That only holds while all binding goes through them, so raw
+// glBind* and glUniform* calls are not to be mixed in.
 struct Uniform {
   void operator=(int x);   // NOLINT(misc-unconventional-assign-operator)
   void operator=(float x); // NOLINT(misc-unconventional-assign-operator)
@@ -35,11 +51,14 @@ struct Uniform {
   void
   operator=(const glm::mat4 &x); // NOLINT(misc-unconventional-assign-operator)
   int id;
+  unsigned program;
 };
 struct Program {
   Program();
   void attach(const Shader &shader);
   void link();
+  void beginLink();
+  void endLink();
   void use();
   Uniform locateUniform(const char *name);
   unsigned id;
@@ -68,8 +87,12 @@ struct Texture {
   void image2D(GLenum target, GLint level, GLint internalFormat, GLsizei width,
                GLsizei height, GLint border, GLenum format, GLenum type,
                const void *pixels);
+  void subImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                  GLsizei width, GLsizei height, GLenum format, GLenum type,
+                  const void *pixels);
   void parameter(GLenum target, GLenum pname, GLint param);
   void xactivateAndBind(GLenum slot, GLenum target);
+  void free();
   unsigned id;
 };
 struct VAO {
@@ -82,11 +105,13 @@ struct VAO {
 struct VBO {
   VBO();
   void bindBuffer(GLenum target);
+  void unbind(GLenum target);
   template <unsigned n> void xbindAndBufferStatic(const float (&vertices)[n]) {
     xbindAndBufferStatic(vertices, n);
   }
   void xbindAndBufferStatic(const std::vector<float> &vertices);
   void xbindAndBufferStatic(const float *vertices, unsigned n);
+  void xbindAndBufferStream(const float *vertices, unsigned n);
   unsigned id;
 };
 struct EBO {
@@ -97,6 +122,8 @@ struct EBO {
   }
   void xbindAndBufferStatic(const std::vector<unsigned> &indices);
   void xbindAndBufferStatic(const unsigned *indices, unsigned n);
+  void xbindAndBufferStatic(const std::vector<unsigned short> &indices);
+  void xbindAndBufferStatic(const unsigned short *indices, unsigned n);
   unsigned id;
 };
 struct RBO {
@@ -105,6 +132,7 @@ struct RBO {
   void unbind(GLenum target);
   void storage(GLenum target, GLenum internalFormat, GLsizei width,
                GLsizei height);
+  void free();
   unsigned id;
 };
 struct FBO {
@@ -117,6 +145,7 @@ struct FBO {
                     RBO &renderbuffer);
   GLenum checkStatus(GLenum target);
   void xassertComplete(GLenum target);
+  void free();
   unsigned id;
 };
 struct GLFW {
@@ -133,6 +162,7 @@ struct ScreenInfo {
 };
 
 std::string readFile(const std::string &path);
+Shader shaderFromSource(const std::string &source, GLenum type);
 Shader shaderFromFile(const std::string &path, GLenum type);
 Program shaderProgramFromShaders(const Shader &vertex, const Shader &fragment);
 Program shaderProgramFromFiles(const std::string &vertexPath,
@@ -140,8 +170,16 @@ Program shaderProgramFromFiles(const std::string &vertexPath,
 Program shaderProgramFromAsset(const std::string &vertexName,
                                const std::string &fragmentName);
 Texture textureFromFile(const std::string &path, GLenum format);
-void loadGLAD();
+// Loads GL through loader, which xprocAddress() then uses for entry points
+// glad does not cover.
+void loadGLAD(GLADloadproc loader);
+void *xprocAddress(const char *name);
 void xclear(glm::vec3 backgroundColor, GLbitfield mask);
+// Makes fbo what FBO::unbind() returns to in place of the window's
+// framebuffer, for rendering without a window, and binds it.
+void xdefaultFramebuffer(FBO &fbo);
+// Binds what FBO::unbind() binds, where there is no FBO at hand.
+void xbindDefaultFramebuffer(GLenum target);
 
 struct ToggleButton {
   bool state;